@@ -1,5 +1,9 @@
 #include "application.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
 #include <thread>
 #include <Poco/FileChannel.h>
 #include <Poco/FormattingChannel.h>
@@ -16,14 +20,32 @@ Elspot::Elspot()
 {
 }
 
-void Elspot::init(int /*argc*/, char* /*argv*/[])
+void Elspot::init(int argc, char* argv[])
 {
   ::SetApp(this);
+
+  for (int arg_index=1; arg_index<argc; arg_index++)
+  {
+    std::string arg(argv[arg_index]);
+    unsigned long first_day, last_day;
+    if (arg.starts_with(BACKFILL_ARGUMENT) &&
+        2 == std::sscanf(arg.c_str()+std::strlen(BACKFILL_ARGUMENT), "%8lu:%8lu", &first_day, &last_day))
+    {
+      m_backfill_range = std::make_pair(first_day, last_day);
+    }
+    else
+    {
+      std::cerr << "Unknown argument " << arg << ". Usage: elspot [" << BACKFILL_ARGUMENT << "yyyymmdd:yyyymmdd]" << std::endl;
+    }
+  }
+
   m_config = new Poco::Util::PropertyFileConfiguration("elspot.properties");
 
-  SetCurrency(std::make_shared<Currency>());
-  SetMQTT(std::make_shared<MQTT>());
-  SetSpotprice(std::make_shared<Spotprice>());
+  SetCurrency(std::make_shared<Currency>(GetConfig(CURRENCIES_PROPERTY, Currency::DEFAULT_CURRENCIES),
+                                         static_cast<unsigned int>(std::max(GetConfigInt(EXCHANGERATESAPI_MONTHLY_QUOTA_PROPERTY, Currency::DEFAULT_MONTHLY_QUOTA), 0))));
+  SetSpotprice(std::make_shared<Spotprice>(ZoneCatalogue(GetConfig(ZONES_PROPERTY, ZoneCatalogue::DEFAULT_ZONES)),
+                                           static_cast<unsigned int>(std::max(GetConfigInt(ENTSOE_REQUESTS_PER_MINUTE_PROPERTY, Spotprice::DEFAULT_REQUESTS_PER_MINUTE), 1))));
+  SetMQTT(std::make_shared<MQTT>()); //After Spotprice and Currency, as it sizes its buffer from the configured zones and currencies
   SetSVG(std::make_shared<SVG>());
   SetNetworking(std::make_shared<Networking>());
 }
@@ -43,12 +65,54 @@ int Elspot::run()
   Poco::Logger::get(Logger::DEFAULT).setChannel(log_formattingchannel);
   Poco::Logger::get(Logger::DEFAULT).setLevel(Poco::Message::PRIO_INFORMATION);
 
+  std::string snapshot_file = GetConfig(SNAPSHOT_FILE_PROPERTY, "");
+  if (!snapshot_file.empty())
+  {
+    SetSnapshot(std::make_shared<Snapshot>(snapshot_file));
+    (void)GetSnapshot()->Load();
+  }
+
+  if (m_backfill_range.has_value())
+  {
+    return RunBackfill();
+  }
+
   std::stop_source stop_source;
   std::jthread mqtt_cron_thread{mqtt_cron, stop_source.get_token()};
   std::jthread spotprice_cron_thread{spotprice_cron, stop_source.get_token()};
   return 0;
 }
 
+int Elspot::RunBackfill()
+{
+  NorwegianDay first_day(m_backfill_range->first);
+  NorwegianDay last_day(m_backfill_range->second);
+  if (last_day < first_day || first_day.StartAsUTCTime().AsNorwegianDay() != first_day || last_day.StartAsUTCTime().AsNorwegianDay() != last_day)
+  {
+    std::cerr << "Invalid backfill range " << m_backfill_range->first << ":" << m_backfill_range->second << std::endl;
+    return Poco::Util::Application::EXIT_USAGE;
+  }
+
+  Poco::Logger::get(Logger::DEFAULT).information(std::string("Backfilling spotprices and exchange rates for ")+first_day.ToString()+" - "+last_day.ToString());
+  bool status = GetSpotprice()->Backfill(first_day, last_day);
+  status &= GetCurrency()->Backfill(first_day, last_day);
+  if (GetSnapshot().get())
+  {
+    status &= GetSnapshot()->Save();
+  }
+  std::cout << "Backfill " << (status ? "complete" : "incomplete, see log") << std::endl;
+  return status ? Poco::Util::Application::EXIT_OK : Poco::Util::Application::EXIT_SOFTWARE;
+}
+
+void Elspot::SaveSnapshot()
+{
+  const std::shared_ptr<Snapshot> snapshot = GetSnapshot();
+  if (snapshot.get() && !snapshot->Save())
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning("Saving snapshot failed");
+  }
+}
+
 void Elspot::release()
 {
 }
@@ -57,3 +121,23 @@ std::string Elspot::GetConfig(const std::string& key) const
 {
   return m_config->getString(key);
 }
+
+std::string Elspot::GetConfig(const std::string& key, const std::string& default_value) const
+{
+  return m_config->getString(key, default_value);
+}
+
+int Elspot::GetConfigInt(const std::string& key, int default_value) const
+{
+  return m_config->getInt(key, default_value);
+}
+
+bool Elspot::GetConfigBool(const std::string& key, bool default_value) const
+{
+  return m_config->getBool(key, default_value);
+}
+
+void Elspot::SetConfig(const std::string& key, const std::string& value)
+{
+  m_config->setString(key, value);
+}
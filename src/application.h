@@ -1,6 +1,9 @@
 #ifndef _APPLICATION_H_
 #define _APPLICATION_H_
 
+#include <optional>
+#include <utility>
+
 #include <Poco/Util/Application.h>
 #include <Poco/Util/PropertyFileConfiguration.h>
 
@@ -9,6 +12,7 @@
 #include "mqtt.h"
 #include "mqtt_cron.h"
 #include "networking.h"
+#include "snapshot.h"
 #include "spotprice.h"
 #include "spotprice_cron.h"
 #include "svg.h"
@@ -19,8 +23,24 @@ class Elspot : public Poco::Util::Application
 public:
   static constexpr const char* ENTSOE_TOKEN_PROPERTY = "entsoe";
   static constexpr const char* EXCHANGERATESAPI_TOKEN_PROPERTY = "exchangeratesapi";
+  static constexpr const char* EXCHANGERATESAPI_MONTHLY_QUOTA_PROPERTY = "exchangeratesapi_monthly_quota";
+  static constexpr const char* MQTT_MAX_INFLIGHT_PROPERTY = "mqtt_max_inflight";
+  static constexpr const char* MQTT_FULL_REPUBLISH_HOURS_PROPERTY = "mqtt_full_republish_hours";
+  static constexpr const char* MQTT_DAY_PAYLOADS_PROPERTY = "mqtt_day_payloads"; //Comma-separated, json and/or cbor
+  static constexpr const char* MQTT_V5_PROPERTY = "mqtt_v5"; //Topic aliases, message expiry and user properties
+  static constexpr const char* MQTT_TOPIC_ALIAS_MAXIMUM_PROPERTY = "mqtt_topic_alias_maximum";
+  static constexpr const char* MQTT_QUEUE_FILE_PROPERTY = "mqtt_queue_file"; //Messages waiting for an unreachable broker. Empty keeps them in memory only
+  static constexpr const char* MQTT_LEGACY_TOPICS_PROPERTY = "mqtt_legacy_topics"; //One topic per slot and value
+  static constexpr const char* MQTT_OPTIMISER_PROPERTY = "mqtt_optimiser"; //Answer scheduling requests on nordpool/optimiser/request
+  static constexpr const char* CURRENCIES_PROPERTY = "currencies"; //Comma-separated currencies besides EUR, like NOK,SEK,DKK,GBP
   static constexpr const char* SVG_DIRECTORY_PROPERTY = "svg_dir";
   static constexpr const char* SVG_TEMPLATE_FILE = "svg_template_file";
+  static constexpr const char* ENTSOE_MAX_CONCURRENT_REQUESTS_PROPERTY = "entsoe_max_concurrent_requests";
+  static constexpr const char* SNAPSHOT_FILE_PROPERTY = "snapshot_file";
+  static constexpr const char* ZONES_PROPERTY = "zones"; //Comma-separated bidding zone ids, like NO-1,SE-3,FI
+  static constexpr const char* ENTSOE_REQUESTS_PER_MINUTE_PROPERTY = "entsoe_requests_per_minute";
+
+  static constexpr const char* BACKFILL_ARGUMENT = "--backfill="; //--backfill=yyyymmdd:yyyymmdd fetches spotprices for the given (inclusive) range of Norwegian days, then exits
   
 public:
   Elspot();
@@ -36,14 +56,24 @@ public:
   void SetSpotprice(std::shared_ptr<Spotprice> spotprice) {m_spotprice = spotprice;}
   void SetSVG(std::shared_ptr<SVG> svg) {m_svg = svg;}
   void SetNetworking(std::shared_ptr<Networking> networking) {m_networking = networking;}
+  void SetSnapshot(std::shared_ptr<Snapshot> snapshot) {m_snapshot = snapshot;}
 
   [[nodiscard]] std::shared_ptr<Currency>   GetCurrency() const {return m_currency;}
   [[nodiscard]] std::shared_ptr<MQTT>       GetMQTT() const {return m_mqtt;}
   [[nodiscard]] std::shared_ptr<Spotprice>  GetSpotprice() const {return m_spotprice;}
   [[nodiscard]] std::shared_ptr<SVG>        GetSVG() const {return m_svg;}
   [[nodiscard]] std::shared_ptr<Networking> GetNetworking() const {return m_networking;}
+  [[nodiscard]] std::shared_ptr<Snapshot>   GetSnapshot() const {return m_snapshot;}
+  void SaveSnapshot(); //After a successful fetch or publish. Does nothing if no snapshot is configured
 
   [[nodiscard]] std::string GetConfig(const std::string& key) const;
+  [[nodiscard]] std::string GetConfig(const std::string& key, const std::string& default_value) const;
+  [[nodiscard]] int GetConfigInt(const std::string& key, int default_value) const;
+  [[nodiscard]] bool GetConfigBool(const std::string& key, bool default_value) const;
+  void SetConfig(const std::string& key, const std::string& value); //In memory only. Lets tests override elspot.properties
+
+private:
+  [[nodiscard]] int RunBackfill();
 
 private:
   Logger m_logger;
@@ -54,6 +84,9 @@ private:
   std::shared_ptr<Spotprice>  m_spotprice;
   std::shared_ptr<SVG>        m_svg;
   std::shared_ptr<Networking> m_networking;
+  std::shared_ptr<Snapshot>   m_snapshot; //Only set when running as an application, so tests never read or write snapshots
+
+  std::optional<std::pair<unsigned long, unsigned long>> m_backfill_range;
 };
 
 [[nodiscard]] Elspot* GetApp();
@@ -0,0 +1,35 @@
+#ifndef _BINARYIO_H_
+#define _BINARYIO_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+
+//Raw values and length-prefixed strings in native byte order, for files only read back by the same build (snapshot, MQTT outbound queue)
+class BinaryIO
+{
+public:
+  template<typename T> static void Write(std::ostream& stream, const T& value) {stream.write(reinterpret_cast<const char*>(&value), sizeof(T));}
+  template<typename T> [[nodiscard]] static bool Read(std::istream& stream, T& value) {return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));}
+
+  static void WriteString(std::ostream& stream, const std::string& value)
+  {
+    Write(stream, static_cast<uint32_t>(value.size()));
+    stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+  }
+
+  [[nodiscard]] static bool ReadString(std::istream& stream, std::string& value, uint32_t max_length) //False if longer than max_length, so a corrupt length never allocates much
+  {
+    uint32_t length;
+    if (!Read(stream, length) || length>max_length)
+    {
+      return false;
+    }
+    value.resize(length);
+    return static_cast<bool>(stream.read(value.data(), static_cast<std::streamsize>(length)));
+  }
+};
+
+#endif // _BINARYIO_H_
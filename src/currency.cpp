@@ -1,97 +1,307 @@
 #include "currency.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
 #include <memory>
+#include <sstream>
 
 #include <fmt/printf.h>
 
 #include <Poco/JSON/Parser.h>
 #include <Poco/JSON/Object.h>
+#include <Poco/String.h>
 
 #include "application.h"
 
 
-bool Currency::GetCurrentExchangeRate(double& rate)
+Currency::Currency(const std::string& currencies, unsigned int monthly_quota)
+: m_quota(monthly_quota, monthly_quota/10), //Keep the last 10% for today's and tomorrow's rates
+  m_retry_scheduler(INITIAL_RETRY_DELAY, MAX_RETRY_DELAY)
 {
-  return GetExchangeRate(UTCTime().AsNorwegianDay(), rate);
+  std::istringstream stream(currencies);
+  std::string currency;
+  while (std::getline(stream, currency, ','))
+  {
+    currency.erase(0, currency.find_first_not_of(" \t"));
+    currency.erase(currency.find_last_not_of(" \t")+1);
+    currency = Poco::toUpper(currency);
+    if (3!=currency.size() || !std::all_of(currency.begin(), currency.end(), [](char c) {return c>='A' && c<='Z';}))
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Invalid currency ")+currency);
+    }
+    else if ("EUR"!=currency && std::find(m_currencies.begin(), m_currencies.end(), currency)==m_currencies.end())
+    {
+      m_currencies.push_back(currency);
+      m_symbols += (m_symbols.empty() ? "" : ",") + currency;
+    }
+  }
 }
 
-bool Currency::GetExchangeRate(const NorwegianDay& norwegian_day, double& rate)
+bool Currency::GetCurrentExchangeRates(ExchangeRates& rates)
 {
-  std::map<unsigned long, double>::iterator existing_rate;
-  
-  { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_rates_mutex);
+  return GetExchangeRates(UTCTime().AsNorwegianDay(), rates);
+}
+
+bool Currency::GetExchangeRates(const NorwegianDay& norwegian_day, ExchangeRates& rates)
+{
+  if (m_currencies.empty())
+  {
+    rates.clear();
+    return true; //Only EUR. Nothing to fetch
+  }
+
+  //Already fetched?
+  std::optional<ExchangeRates> found_rates = FindRates(norwegian_day);
+  if (!found_rates)
+  {
+    //Concurrent callers for the same day share one fetch and its result
+    found_rates = m_fetch_flight.Do(norwegian_day.AsULong(), [this, &norwegian_day]() -> std::optional<ExchangeRates>
+      {
+        const std::lock_guard<std::mutex> lock(m_fetch_mutex);
+
+        //Fetched by a previous flight while we waited for the lock?
+        std::optional<ExchangeRates> fetched_rates = FindRates(norwegian_day);
+        if (!fetched_rates && FetchEur(norwegian_day))
+        {
+          fetched_rates = FindRates(norwegian_day);
+        }
+        return fetched_rates;
+      });
+  }
 
-    //Already fetched?
-    existing_rate = m_rates.find(norwegian_day.AsULong());
-    if (existing_rate != m_rates.end())
+  if (!found_rates)
+  {
+    return false;
+  }
+  rates = std::move(*found_rates);
+  return true;
+}
+
+std::vector<PriceSeries> Currency::Convert(const PriceSeries& eur_prices, const ExchangeRates& rates)
+{
+  std::vector<PriceSeries> converted;
+  converted.reserve(rates.size());
+  for (double rate : rates)
+  {
+    converted.push_back(eur_prices.Converted(rate));
+  }
+  return converted;
+}
+
+std::optional<Currency::ExchangeRates> Currency::FindRates(const NorwegianDay& norwegian_day)
+{
+  const std::lock_guard<std::mutex> lock(m_rates_mutex);
+  auto existing_rates = m_rates.find(norwegian_day.AsULong());
+  return (existing_rates == m_rates.end()) ? std::nullopt : std::optional<ExchangeRates>(existing_rates->second);
+}
+
+void Currency::GetCachedRates(std::map<unsigned long, ExchangeRates>& rates)
+{
+  const std::lock_guard<std::mutex> lock(m_rates_mutex);
+  rates = m_rates;
+}
+
+void Currency::SetCachedRates(const std::map<unsigned long, ExchangeRates>& rates)
+{
+  const std::lock_guard<std::mutex> lock(m_rates_mutex);
+  for (const auto& day_rates : rates)
+  {
+    if (day_rates.second.size() == m_currencies.size())
     {
-      rate = existing_rate->second;
-      return true;
+      m_rates.insert(day_rates);
     }
-    
-    //Fetch rate!
-    if (!FetchEur(norwegian_day))
-        return false;
+  }
+}
 
-    //Has it been fetched?
-    existing_rate = m_rates.find(norwegian_day.AsULong());
-    if (existing_rate == m_rates.end())
+bool Currency::Backfill(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  //Today and later are fetched as latest rates, when needed
+  NorwegianDay last_historical_day = std::min(last_day, UTCTime().AsNorwegianDay().IncrementDaysCopy(-1));
+  bool status = true;
+  static constexpr long CHUNK_DAYS = MAX_TIMESERIES_DAYS - LEAD_IN_DAYS; //Each request also covers the lead-in
+  for (NorwegianDay chunk_first_day=first_day; !(last_historical_day<chunk_first_day); chunk_first_day=chunk_first_day.IncrementDaysCopy(CHUNK_DAYS))
+  {
+    NorwegianDay chunk_last_day = std::min(chunk_first_day.IncrementDaysCopy(CHUNK_DAYS-1), last_historical_day);
+    if (IsCached(chunk_first_day, chunk_last_day))
     {
-      return false;
+      continue;
+    }
+
+    const std::lock_guard<std::mutex> lock(m_fetch_mutex);
+    if (FetchEurRange(chunk_first_day, chunk_last_day))
+    {
+      continue;
+    }
+
+    //Timeseries is not on every plan. Fetch the days one by one instead, as long as optional requests are left
+    Poco::Logger::get(Logger::DEFAULT).information(std::string("Currency: Backfilling one day per request for ")+chunk_first_day.ToString()+" - "+chunk_last_day.ToString());
+    for (NorwegianDay day=chunk_first_day; !(chunk_last_day<day); day=day.IncrementDaysCopy(1))
+    {
+      if (FindRates(day))
+      {
+        continue;
+      }
+      if (0 == m_quota.GetRemaining(MonthlyQuota::Priority::OPTIONAL))
+      {
+        Poco::Logger::get(Logger::DEFAULT).warning("Currency: Monthly quota for optional requests exhausted during backfill");
+        return false;
+      }
+      if (!FetchEurHistorical(day, MonthlyQuota::Priority::OPTIONAL))
+      {
+        Poco::Logger::get(Logger::DEFAULT).error(std::string("Currency: Backfill incomplete for ")+day.ToString());
+        status = false;
+      }
     }
   }
-  
-  //It has been fetched! Return it
-  rate = (*existing_rate).second;
-  return true;
+  return status;
+}
+
+bool Currency::IsCached(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  const std::lock_guard<std::mutex> lock(m_rates_mutex);
+  auto first = m_rates.lower_bound(first_day.AsULong());
+  auto last = m_rates.upper_bound(last_day.AsULong());
+  return std::distance(first, last) == last_day.DaysAfter(first_day)+1;
 }
 
 bool Currency::FetchEur(const NorwegianDay& norwegian_day)
 {
-  //Remove expired failures
-  auto fail_expire_time = std::chrono::system_clock::now() - RETRY_DURATION;
+  NorwegianDay norwegian_today = UTCTime().AsNorwegianDay();
+  if (norwegian_day < norwegian_today)
+  {
+    return FetchEurHistorical(norwegian_day, MonthlyQuota::Priority::ESSENTIAL); //Asked for by spotprice_cron or MQTT, so as essential as today's rate
+  }
 
-  { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_failmap_mutex);
+  if (!m_retry_scheduler.MayAttempt(norwegian_day.AsULong())) //Recently failed?
+  {
+    return false;
+  }
 
-#if 0    
-    std::erase_if(m_failmap, [fail_expire_time](const auto& item) {
-      auto const& [key, value] = item;
-      return value < fail_expire_time;
-    });
+#if 1 //Actually fetch exchange rate. There is a limit on free requests per month
+  Poco::JSON::Object::Ptr rates_object;
+  ExchangeRates rates;
+  if (!FetchJSON(fmt::sprintf(EUR_LATEST_URL, ::GetApp()->GetConfig(Elspot::EXCHANGERATESAPI_TOKEN_PROPERTY), m_symbols), MonthlyQuota::Priority::ESSENTIAL, rates_object) ||
+      !ParseRates(rates_object, rates))
+  {
+    return RegisterFail(norwegian_day);
+  }
+  StoreRates({{norwegian_day.AsULong(), rates}});
 #else
-    for (std::map<unsigned long, std::chrono::system_clock::time_point>::iterator it=m_failmap.begin(); it!=m_failmap.end(); ++it)
-    {
-        if (it->second < fail_expire_time)
-        {
-          m_failmap.erase(it);
-        }
-    }
+  Poco::Logger::get(Logger::DEFAULT).information("Currency::FetchEur hardcoding 10.2");
+  StoreRates({{norwegian_day.AsULong(), ExchangeRates(m_currencies.size(), 10.2)}});
 #endif
+  m_retry_scheduler.RegisterSuccess(norwegian_day.AsULong());
+  return true;
+}
+
+bool Currency::FetchEurHistorical(const NorwegianDay& norwegian_day, MonthlyQuota::Priority priority)
+{
+  if (!m_retry_scheduler.MayAttempt(norwegian_day.AsULong())) //Recently failed?
+  {
+    return false;
+  }
+
+  //Weekends and holidays are answered with the previous rate
+  Poco::JSON::Object::Ptr rates_object;
+  ExchangeRates rates;
+  if (!FetchJSON(fmt::sprintf(EUR_HISTORICAL_URL, norwegian_day.GetYear(), norwegian_day.GetMonth(), norwegian_day.GetDay(),
+                              ::GetApp()->GetConfig(Elspot::EXCHANGERATESAPI_TOKEN_PROPERTY), m_symbols), priority, rates_object) ||
+      !ParseRates(rates_object, rates))
+  {
+    return RegisterFail(norwegian_day);
+  }
+  StoreRates({{norwegian_day.AsULong(), rates}});
+  m_retry_scheduler.RegisterSuccess(norwegian_day.AsULong());
+  return true;
+}
 
-    if (m_failmap.find(norwegian_day.AsULong()) != m_failmap.end()) //Recently failed?
+bool Currency::FetchEurRange(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  //No retry scheduling. Backfill runs once, and falls back to FetchEurHistorical, which does its own
+  const NorwegianDay request_first_day = first_day.IncrementDaysCopy(-LEAD_IN_DAYS);
+  Poco::JSON::Object::Ptr rates_object;
+  if (!FetchJSON(fmt::sprintf(EUR_TIMESERIES_URL, ::GetApp()->GetConfig(Elspot::EXCHANGERATESAPI_TOKEN_PROPERTY),
+                              request_first_day.GetYear(), request_first_day.GetMonth(), request_first_day.GetDay(),
+                              last_day.GetYear(), last_day.GetMonth(), last_day.GetDay(), m_symbols),
+                 MonthlyQuota::Priority::OPTIONAL, rates_object))
+  {
+    return RegisterRangeFail(first_day, last_day);
+  }
+
+  std::map<unsigned long, ExchangeRates> rates;
+  try
+  {
+    //Timeseries rates are keyed on date, like {"2023-01-04":{"NOK":10.707833,"SEK":11.144894}}
+    std::map<unsigned long, ExchangeRates> fetched_rates;
+    for (const std::string& date : rates_object->getNames())
     {
-      return false;
+      unsigned int year, month, day;
+      ExchangeRates day_rates;
+      if (3 == std::sscanf(date.c_str(), "%4u-%2u-%2u", &year, &month, &day) && ParseRates(rates_object->getObject(date), day_rates))
+      {
+        fetched_rates[year*10000UL + month*100UL + day] = std::move(day_rates);
+      }
     }
+
+    rates = FillRateGaps(fetched_rates, first_day, last_day, FindRates(first_day.IncrementDaysCopy(-1)));
+  }
+  catch (Poco::Exception& ex)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(ex.message());
+    return RegisterRangeFail(first_day, last_day);
   }
 
-  try
+  if (rates.empty())
   {
-#if 1 //Actually fetch exchange rate. There is a limit on free requests per month
-    Poco::URI uri;
-    NorwegianDay norwegian_today = UTCTime().AsNorwegianDay();
-    if (norwegian_day < norwegian_today)
+    return RegisterRangeFail(first_day, last_day);
+  }
+  StoreRates(rates);
+  return true;
+}
+
+std::map<unsigned long, Currency::ExchangeRates> Currency::FillRateGaps(const std::map<unsigned long, ExchangeRates>& fetched_rates, const NorwegianDay& first_day, const NorwegianDay& last_day,
+                                                                        std::optional<ExchangeRates> previous_rate)
+{
+  //There are no rates on weekends and holidays. Use the previous rates, like the historical endpoint does.
+  //The lead-in before first_day normally has one. If not, the first rate in the range is better than leaving the days uncached, and refetching them forever
+  auto lead_in_rate = fetched_rates.lower_bound(first_day.AsULong());
+  if (lead_in_rate != fetched_rates.begin())
+  {
+    previous_rate = std::prev(lead_in_rate)->second;
+  }
+  else if (!previous_rate && lead_in_rate!=fetched_rates.end() && lead_in_rate->first<=last_day.AsULong())
+  {
+    previous_rate = lead_in_rate->second;
+  }
+
+  std::map<unsigned long, ExchangeRates> rates;
+  for (NorwegianDay day=first_day; !(last_day<day); day=day.IncrementDaysCopy(1))
+  {
+    auto fetched_rate = fetched_rates.find(day.AsULong());
+    if (fetched_rate != fetched_rates.end())
     {
-      uri = Poco::URI(fmt::sprintf(EUR_HISTORICAL_URL,
-                                   norwegian_day.GetYear(), norwegian_day.GetMonth(), norwegian_day.GetDay(),
-                                   ::GetApp()->GetConfig(Elspot::EXCHANGERATESAPI_TOKEN_PROPERTY)));
+      previous_rate = fetched_rate->second;
     }
-    else
+    if (previous_rate)
     {
-      uri = Poco::URI(fmt::sprintf(EUR_LATEST_URL, ::GetApp()->GetConfig(Elspot::EXCHANGERATESAPI_TOKEN_PROPERTY)));
+      rates[day.AsULong()] = *previous_rate;
     }
+  }
+  return rates;
+}
 
+bool Currency::FetchJSON(const std::string& url, MonthlyQuota::Priority priority, Poco::JSON::Object::Ptr& rates_object)
+{
+  if (!m_quota.TryConsume(priority))
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(fmt::sprintf("Currency: Monthly quota exhausted for %s requests", MonthlyQuota::Priority::ESSENTIAL==priority ? "essential" : "optional"));
+    return false;
+  }
+
+  try
+  {
+    Poco::URI uri(url);
     const std::shared_ptr<Networking> networking = ::GetApp()->GetNetworking();
     if (!networking.get())
     {
@@ -102,80 +312,96 @@ bool Currency::FetchEur(const NorwegianDay& norwegian_day)
 
     Poco::Net::HTTPResponse res;
     Poco::JSON::Parser parser;
-    auto json_root = parser.parse(session->receiveResponse(res));
+    std::unique_ptr<ResponseBody> response_body = Networking::ReceiveResponse(session, res);
+    auto json_root = parser.parse(response_body->Stream());
     if (Poco::Net::HTTPResponse::HTTP_OK != res.getStatus())
     {
-      return RegisterFail(norwegian_day);
+      return false;
     }
+    response_body->Drain();
+    networking->ReleaseSession(uri, session); //Response has been read completely. Keep connection warm for next request
 
     if (!json_root)
     {
-      return RegisterFail(norwegian_day);
+      return false;
     }
 
     auto object_root = json_root.extract<Poco::JSON::Object::Ptr>();
     if (!object_root)
     {
-      return RegisterFail(norwegian_day);
+      return false;
     }
 
     std::string base_currency = object_root->getValue<std::string>("base");
     if (0 != base_currency.compare("EUR"))
     {
-      return RegisterFail(norwegian_day);
-    }
-
-    Poco::JSON::Object::Ptr rates_object = object_root->getObject("rates");
-    if (!rates_object)
-    {
-      return RegisterFail(norwegian_day);
-    }
-
-    //Remove any old values
-#if 0
-    std::erase_if(m_rates, [norwegian_day](const auto& item)
-      {
-        auto const& [key, value] = item;
-        return norwegian_day.DaysAfter(key) > 1;
-      });
-#else
-    for (std::map<unsigned long, double>::iterator it=m_rates.begin(); it!=m_rates.end(); ++it)
-    {
-        if (norwegian_day.DaysAfter(it->first) > 1)
-        {
-          m_rates.erase(it);
-        }
+      return false;
     }
-#endif
 
-    double exchange_rate = rates_object->getValue<double>("NOK");
-    m_rates.insert({norwegian_day.AsULong(), exchange_rate});
-#else
-    Poco::Logger::get(Logger::DEFAULT).information("Currency::FetchEur hardcoding 10.2");
-    m_rates.insert({norwegian_day.AsULong(), 10.2});
-#endif
-    return true;
+    rates_object = object_root->getObject("rates");
+    return !rates_object.isNull();
   }
   catch (Poco::Exception& ex)
   {
     Poco::Logger::get(Logger::DEFAULT).error(ex.message());
-    return RegisterFail(norwegian_day);
+    return false;
   }
   catch (...)
   {
     Poco::Logger::get(Logger::DEFAULT).error("Got currency exception");
-    return RegisterFail(norwegian_day);
+    return false;
   }
 }
 
-bool Currency::RegisterFail(const NorwegianDay& norwegian_day)
+bool Currency::ParseRates(const Poco::JSON::Object::Ptr& rates_object, ExchangeRates& rates) const
+{
+  if (rates_object.isNull())
+  {
+    return false;
+  }
+
+  rates.resize(m_currencies.size());
+  for (std::size_t currency_index=0; currency_index<m_currencies.size(); currency_index++)
+  {
+    if (!rates_object->has(m_currencies[currency_index]))
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Currency: No exchange rate for ")+m_currencies[currency_index]);
+      return false;
+    }
+    rates[currency_index] = rates_object->getValue<double>(m_currencies[currency_index]);
+  }
+  return true;
+}
+
+void Currency::StoreRates(const std::map<unsigned long, ExchangeRates>& rates)
 {
+  NorwegianDay oldest_day = UTCTime().AsNorwegianDay().IncrementDaysCopy(-MAX_CACHED_DAYS);
   { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_failmap_mutex);
+    const std::lock_guard<std::mutex> lock(m_rates_mutex);
+    for (const auto& rate : rates)
+    {
+      m_rates[rate.first] = rate.second;
+    }
 
-    Poco::Logger::get(Logger::DEFAULT).error(std::string("Fetching exchange rate failed for ")+norwegian_day.ToString());
-    m_failmap.insert({norwegian_day.AsULong(), std::chrono::system_clock::now()});
+    //Remove any old values. Old rates are kept, so a backfill does not need to fetch them again
+    m_rates.erase(m_rates.begin(), m_rates.lower_bound(oldest_day.AsULong()));
   }
-  
+  ::GetApp()->SaveSnapshot(); //Rates and the quota used to get them, so a restart does not spend requests on them again
+}
+
+bool Currency::RegisterFail(const NorwegianDay& norwegian_day)
+{
+  RetryScheduler::TimePoint next_attempt = m_retry_scheduler.RegisterFail(norwegian_day.AsULong());
+  Poco::Logger::get(Logger::DEFAULT).error(fmt::sprintf("Fetching exchange rate failed for %s. Retry in %d seconds",
+                                           norwegian_day.ToString(),
+                                           std::chrono::duration_cast<std::chrono::seconds>(next_attempt - std::chrono::system_clock::now()).count()));
+  ::GetApp()->SaveSnapshot(); //A failed request still counts against the monthly quota
+  return false;
+}
+
+bool Currency::RegisterRangeFail(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  Poco::Logger::get(Logger::DEFAULT).warning(std::string("Fetching exchange rate timeseries failed for ")+first_day.ToString()+" - "+last_day.ToString());
+  ::GetApp()->SaveSnapshot(); //A failed request still counts against the monthly quota
   return false;
 }
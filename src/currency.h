@@ -4,31 +4,82 @@
 #include <chrono>
 #include <map>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <Poco/JSON/Object.h>
 
 #include "day.h"
+#include "priceseries.h"
+#include "quota.h"
+#include "retry.h"
+#include "singleflight.h"
 
 
+//EUR exchange rates for the configured currencies. All currencies are fetched in one request and stored together per day
 class Currency
 {
+public:
+  typedef std::vector<double> ExchangeRates; //Units of each configured currency for 1 EUR, indexed like GetCurrencies()
+
 private:
-  static constexpr std::chrono::minutes RETRY_DURATION = std::chrono::minutes(10);
-  static constexpr const char* EUR_HISTORICAL_URL = "http://api.exchangeratesapi.io/v1/%04d-%02d-%02d?access_key=%s&base=EUR&symbols=NOK";
-  static constexpr const char* EUR_LATEST_URL   = "http://api.exchangeratesapi.io/v1/latest?access_key=%s&base=EUR&symbols=NOK";
+  static constexpr std::chrono::minutes INITIAL_RETRY_DELAY = std::chrono::minutes(2);
+  static constexpr std::chrono::minutes MAX_RETRY_DELAY = std::chrono::minutes(60); //There is a limit on free requests per month
+  static constexpr const char* EUR_HISTORICAL_URL = "http://api.exchangeratesapi.io/v1/%04d-%02d-%02d?access_key=%s&base=EUR&symbols=%s";
+  static constexpr const char* EUR_TIMESERIES_URL = "http://api.exchangeratesapi.io/v1/timeseries?access_key=%s&start_date=%04d-%02d-%02d&end_date=%04d-%02d-%02d&base=EUR&symbols=%s";
+  static constexpr const char* EUR_LATEST_URL   = "http://api.exchangeratesapi.io/v1/latest?access_key=%s&base=EUR&symbols=%s";
+  static constexpr long MAX_TIMESERIES_DAYS = 365; //Limit per timeseries request
+  static constexpr long LEAD_IN_DAYS = 7; //Requested before the first day, so weekends and holidays at the start of a range have a previous rate
+  static constexpr long MAX_CACHED_DAYS = 2*366;
+
+public:
+  static constexpr int DEFAULT_MONTHLY_QUOTA = 250; //Free plan. It has no timeseries endpoint, so backfill fetches one day per request
+  static constexpr const char* DEFAULT_CURRENCIES = "NOK";
 
 public:
-  [[nodiscard]] bool GetCurrentExchangeRate(double& rate);
-  [[nodiscard]] bool GetExchangeRate(const NorwegianDay& norwegian_day, double& rate);
+  Currency() : Currency(DEFAULT_CURRENCIES, DEFAULT_MONTHLY_QUOTA) {}
+  Currency(const std::string& currencies, unsigned int monthly_quota); //Comma-separated ISO 4217 codes, like NOK,SEK,DKK,GBP
+
+public:
+  [[nodiscard]] const std::vector<std::string>& GetCurrencies() const {return m_currencies;}
+  [[nodiscard]] bool GetCurrentExchangeRates(ExchangeRates& rates);
+  [[nodiscard]] bool GetExchangeRates(const NorwegianDay& norwegian_day, ExchangeRates& rates);
+  [[nodiscard]] static std::vector<PriceSeries> Convert(const PriceSeries& eur_prices, const ExchangeRates& rates); //One series per currency, indexed like rates
+  //Rates for every day in [first_day, last_day]. Days without rates (weekends and holidays) use the previous rate, or the first one if nothing precedes them
+  [[nodiscard]] static std::map<unsigned long, ExchangeRates> FillRateGaps(const std::map<unsigned long, ExchangeRates>& fetched_rates, const NorwegianDay& first_day, const NorwegianDay& last_day,
+                                                                          std::optional<ExchangeRates> previous_rate);
+
+  //One timeseries request per MAX_TIMESERIES_DAYS-LEAD_IN_DAYS not already cached. Where timeseries fails (or the plan does not have it), one request per day not cached
+  [[nodiscard]] bool Backfill(const NorwegianDay& first_day, const NorwegianDay& last_day);
+
+  void GetCachedRates(std::map<unsigned long, ExchangeRates>& rates);
+  void SetCachedRates(const std::map<unsigned long, ExchangeRates>& rates);
+  [[nodiscard]] MonthlyQuota& GetQuota() {return m_quota;}
 
 private:
-  [[nodiscard]] bool FetchEur(const NorwegianDay& norwegian_day); //Not thread-safe funtion. Call from within locked m_rates_mutex
+  [[nodiscard]] bool FetchEur(const NorwegianDay& norwegian_day); //Not thread-safe funtion. Call from within locked m_fetch_mutex
+  [[nodiscard]] bool FetchEurHistorical(const NorwegianDay& norwegian_day, MonthlyQuota::Priority priority); //One past day. Call from within locked m_fetch_mutex
+  [[nodiscard]] bool FetchEurRange(const NorwegianDay& first_day, const NorwegianDay& last_day); //Timeseries of past days, for Backfill only. Call from within locked m_fetch_mutex
+  [[nodiscard]] bool FetchJSON(const std::string& url, MonthlyQuota::Priority priority, Poco::JSON::Object::Ptr& rates_object);
+  [[nodiscard]] bool ParseRates(const Poco::JSON::Object::Ptr& rates_object, ExchangeRates& rates) const; //False unless all currencies are present
+  [[nodiscard]] bool IsCached(const NorwegianDay& first_day, const NorwegianDay& last_day);
+  void StoreRates(const std::map<unsigned long, ExchangeRates>& rates);
+  [[nodiscard]] std::optional<ExchangeRates> FindRates(const NorwegianDay& norwegian_day);
   [[nodiscard]] bool RegisterFail(const NorwegianDay& norwegian_day);
+  [[nodiscard]] bool RegisterRangeFail(const NorwegianDay& first_day, const NorwegianDay& last_day); //Not retry scheduled, see FetchEurRange
 
 private:
-  std::map<unsigned long, double> m_rates;
-  std::mutex m_rates_mutex;
+  std::vector<std::string> m_currencies;
+  std::string m_symbols; //m_currencies as the symbols parameter, like "NOK,SEK"
+
+  std::map<unsigned long, ExchangeRates> m_rates;
+  std::mutex m_rates_mutex; //Only held while reading or updating m_rates, never during a fetch
+  std::mutex m_fetch_mutex;
+  MonthlyQuota m_quota;
+  SingleFlight<unsigned long, std::optional<ExchangeRates>> m_fetch_flight; //Keyed on NorwegianDay::AsULong()
   
-  std::map<unsigned long, std::chrono::system_clock::time_point> m_failmap;
-  std::mutex m_failmap_mutex;
+  RetryScheduler m_retry_scheduler;
 };
 
 #endif // _CURRENCY_H_
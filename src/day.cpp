@@ -1,215 +1,191 @@
 #include "day.h"
 
+#include <atomic>
 #include <chrono>
-#include <cstring>
 
 #include <fmt/printf.h>
 
+#include "timezone.h"
+
+
+static_assert(sizeof(UTCTime) == sizeof(std::time_t));
 
 UTCTime::UTCTime()
+: m_time_utc(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()))
 {
-  Initialize(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
 }
 
-UTCTime::UTCTime(const std::time_t& time)
+UTCTime::UTCTime(const std::string& time)
 {
-  Initialize(time);
+  int year = 1970;
+  unsigned int month = 1, day = 1, hour = 0, minute = 0;
+  std::sscanf(time.c_str(), "%4d-%2u-%2uT%2u:%2uZ", &year, &month, &day, &hour, &minute);
+  m_time_utc = static_cast<std::time_t>(DaysFromCivil(year, month, day)*SECONDS_PER_DAY + hour*60*60 + minute*60);
 }
 
-UTCTime::UTCTime(const std::string& time)
+uint16_t UTCTime::GetYear() const
 {
-  std::tm tm = {};
-  std::sscanf(time.c_str(), "%4u-%2u-%2uT%2u:%2uZ", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min);
-  tm.tm_year -= 1900;
-  tm.tm_mon--;
-  Initialize(::timegm(&tm));
+  int year;
+  unsigned int month, day;
+  CivilFromDays(DaysSinceEpoch(), year, month, day);
+  return static_cast<uint16_t>(year);
 }
 
-void UTCTime::Initialize(const std::time_t& time)
+uint8_t UTCTime::GetMonth() const
 {
-  m_time_utc = time;
-  ::gmtime_r(&m_time_utc, &m_time_tm_utc);
+  int year;
+  unsigned int month, day;
+  CivilFromDays(DaysSinceEpoch(), year, month, day);
+  return static_cast<uint8_t>(month);
 }
 
-UTCTime UTCTime::IncrementSecondsCopy(const std::time_t& seconds) const
+uint8_t UTCTime::GetDay() const
 {
-  return UTCTime(m_time_utc + seconds);
+  int year;
+  unsigned int month, day;
+  CivilFromDays(DaysSinceEpoch(), year, month, day);
+  return static_cast<uint8_t>(day);
 }
 
 UTCTime UTCTime::IncrementNorwegianDaysCopy(const std::time_t& days) const
 {
   UTCTime adjusted_time(m_time_utc + days*24*60*60);
-  return adjusted_time.DecrementSecondsCopy(GetNorwegianTimezoneOffset() - adjusted_time.GetNorwegianTimezoneOffset());
+  return adjusted_time.IncrementSecondsCopy(GetNorwegianTimezoneOffset() - adjusted_time.GetNorwegianTimezoneOffset());
 }
 
 const NorwegianDay UTCTime::AsNorwegianDay() const
 {
-  std::tm time_tm_norwegiantime;
-  time_t norwegiantime = m_time_utc+GetNorwegianTimezoneOffset();
-  ::gmtime_r(&norwegiantime, &time_tm_norwegiantime);
-  return NorwegianDay(time_tm_norwegiantime);
+  return AsLocalDay(Timezone::Norway());
 }
 
 const NorwegianTime UTCTime::AsNorwegianTime() const
 {
-  std::tm time_tm_norwegiantime;
-  time_t norwegiantime = m_time_utc+GetNorwegianTimezoneOffset();
-  ::gmtime_r(&norwegiantime, &time_tm_norwegiantime);
-  return NorwegianTime(time_tm_norwegiantime);
+  return AsLocalTime(Timezone::Norway());
 }
 
-UTCTime UTCTime::DaylightSavingStart() const
+const NorwegianDay UTCTime::AsLocalDay(const Timezone& timezone) const
 {
-  std::tm dst_tm;
-  std::memset(&dst_tm, 0, sizeof(std::tm));
-  dst_tm.tm_year = m_time_tm_utc.tm_year;
-  dst_tm.tm_mon = 3-1;
-  dst_tm.tm_mday = LastSundayInMonth(static_cast<uint16_t>(dst_tm.tm_year+1900), static_cast<uint8_t>(dst_tm.tm_mon+1));
-  dst_tm.tm_hour = 1;
-  dst_tm.tm_min = 0;
-  dst_tm.tm_sec = 0;
-  return UTCTime(::timegm(&dst_tm));
+  int year;
+  unsigned int month, day;
+  CivilFromDays(FloorDiv(m_time_utc+timezone.GetOffset(m_time_utc), SECONDS_PER_DAY), year, month, day);
+  return NorwegianDay(static_cast<uint16_t>(year), static_cast<uint8_t>(month), static_cast<uint8_t>(day));
 }
 
-UTCTime UTCTime::DaylightSavingEnd() const
+const NorwegianTime UTCTime::AsLocalTime(const Timezone& timezone) const
 {
-  std::tm dst_tm;
-  std::memset(&dst_tm, 0, sizeof(std::tm));
-  dst_tm.tm_year = m_time_tm_utc.tm_year;
-  dst_tm.tm_mon = 10-1;
-  dst_tm.tm_mday = LastSundayInMonth(static_cast<uint16_t>(dst_tm.tm_year+1900), static_cast<uint8_t>(dst_tm.tm_mon+1));
-  dst_tm.tm_hour = 1;
-  dst_tm.tm_min = 0;
-  dst_tm.tm_sec = 0;
-  return UTCTime(::timegm(&dst_tm));
+  std::time_t localtime = m_time_utc+timezone.GetOffset(m_time_utc);
+  std::int64_t days = FloorDiv(localtime, SECONDS_PER_DAY);
+  std::time_t second_of_day = static_cast<std::time_t>(localtime - days*SECONDS_PER_DAY);
+  int year;
+  unsigned int month, day;
+  CivilFromDays(days, year, month, day);
+  return NorwegianTime(NorwegianDay(static_cast<uint16_t>(year), static_cast<uint8_t>(month), static_cast<uint8_t>(day)),
+                       static_cast<uint8_t>(second_of_day/3600), static_cast<uint8_t>(second_of_day/60%60), static_cast<uint8_t>(second_of_day%60));
 }
 
-std::time_t UTCTime::GetNorwegianTimezoneOffset() const
+UTCTime UTCTime::DaylightSavingStart() const
 {
-  UTCTime dst_start = DaylightSavingStart();
-  UTCTime dst_end = DaylightSavingEnd();
-  return (*this<dst_start || *this>=dst_end) ? 3600 : 7200;
+  return UTCTime(Timezone::Norway().DaylightSavingStart(GetYear()));
 }
 
-uint8_t UTCTime::LastSundayInMonth(uint16_t year, uint8_t month) const
+UTCTime UTCTime::DaylightSavingEnd() const
 {
-  uint8_t wday;
-
-  //From unix/time.c
-  {
-    constexpr short monthbegin[12] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334};
-    std::time_t t = monthbegin[month-1] // full months
-              + (!(year & 3) && (month-1) > 1); // leap day this year
-    t += 365 * (year - 1970) // full years
-        + (year - 1969)/4; // past leap days
-    wday = static_cast<uint8_t>(static_cast<int>(t + 3) % 7);
-  }
+  return UTCTime(Timezone::Norway().DaylightSavingEnd(GetYear()));
+}
 
-  int first_of_month_wday = (wday % 7 + 7) % 7;
-  return (first_of_month_wday<=3) ? static_cast<uint8_t>(28-first_of_month_wday) : static_cast<uint8_t>(35-first_of_month_wday);
+std::time_t UTCTime::GetNorwegianTimezoneOffset() const
+{
+  return Timezone::Norway().GetOffset(m_time_utc);
 }
 
 void UTCTime::SetTime(uint8_t hour, uint8_t minute, uint8_t second)
 {
-  m_time_utc += (hour - m_time_tm_utc.tm_hour)*60*60;
-  m_time_utc += (minute - m_time_tm_utc.tm_min)*60;
-  m_time_utc += (second - m_time_tm_utc.tm_sec);
-  ::gmtime_r(&m_time_utc, &m_time_tm_utc);
+  m_time_utc += (hour*60*60 + minute*60 + second) - SecondOfDay();
 }
 
 void UTCTime::SetHour(uint8_t hour)
 {
-  m_time_utc += (hour - m_time_tm_utc.tm_hour)*60*60;
-  ::gmtime_r(&m_time_utc, &m_time_tm_utc);
+  m_time_utc += (hour - GetHour())*60*60;
 }
 
 void UTCTime::SetMinute(uint8_t minute)
 {
-  m_time_utc += (minute - m_time_tm_utc.tm_min)*60;
-  ::gmtime_r(&m_time_utc, &m_time_tm_utc);
+  m_time_utc += (minute - GetMinute())*60;
 }
 
 void UTCTime::SetSecond(uint8_t second)
 {
-  m_time_utc += (second - m_time_tm_utc.tm_sec);
-  ::gmtime_r(&m_time_utc, &m_time_tm_utc);
+  m_time_utc += (second - GetSecond());
 }
 
 
-NorwegianDay::NorwegianDay(const std::tm time_tm_norwegiantime) :
-  m_year(static_cast<uint16_t>(time_tm_norwegiantime.tm_year+1900)),
-  m_month(static_cast<uint8_t>(time_tm_norwegiantime.tm_mon+1)),
-  m_day(static_cast<uint8_t>(time_tm_norwegiantime.tm_mday))
+std::string NorwegianDay::ToString() const
 {
+  return fmt::sprintf("%u.%s %u", GetDay()%99, m_months[GetMonth()-1], GetYear()%9999);
 }
 
-NorwegianDay::NorwegianDay(unsigned long as_ulong)
+NorwegianDay NorwegianDay::Today()
 {
-  m_day = static_cast<uint8_t>(as_ulong%100);
-  as_ulong = (as_ulong - m_day) / 100;
-  m_month = static_cast<uint8_t>(as_ulong%100);
-  as_ulong = (as_ulong - m_month) / 100;
-  m_year = static_cast<uint16_t>(as_ulong);
-}
+  //Day key in the low 32 bits, the UTC time_t of the following Norwegian midnight in the high 32 bits (valid until 2106).
+  //One atomic, so a reader never sees a day together with another day's midnight
+  static std::atomic<uint64_t> s_today_and_next_midnight{0};
 
-std::string NorwegianDay::ToString() const
-{
-  return fmt::sprintf("%u.%s %u", GetDay()%99, m_months[GetMonth()-1], GetYear()%9999);
+  std::time_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  uint64_t cached = s_today_and_next_midnight.load(std::memory_order_acquire);
+  if (now < static_cast<std::time_t>(cached >> 32))
+  {
+    return NorwegianDay(static_cast<unsigned long>(cached & 0xFFFFFFFFu));
+  }
+
+  NorwegianDay today = UTCTime(now).AsNorwegianDay();
+  uint64_t next_midnight = static_cast<uint32_t>(today.IncrementDaysCopy(1).StartAsUTCTime().AsUTCTimeT());
+  uint64_t updated = (next_midnight << 32) | today.AsULong();
+
+  //Only ever move forward. A thread that computed today just before midnight, and gets here late, must not replace the following day
+  while ((cached >> 32) < next_midnight &&
+         !s_today_and_next_midnight.compare_exchange_weak(cached, updated, std::memory_order_release, std::memory_order_acquire))
+  {
+  }
+  return today;
 }
 
 bool NorwegianDay::IsToday() const
 {
-  NorwegianDay today = UTCTime().AsNorwegianDay();
-  return AsULong() == today.AsULong();
+  return AsULong() == Today().AsULong();
 }
 
 bool NorwegianDay::IsTomorrow() const
 {
-  UTCTime today = UTCTime();
-  NorwegianDay tomorrow = today.IncrementNorwegianDaysCopy(1).AsNorwegianDay();
-  return AsULong() == tomorrow.AsULong();
+  return AsULong() == Today().IncrementDaysCopy(1).AsULong();
 }
 
 signed long NorwegianDay::DaysAfter(const NorwegianDay& other) const
 {
-  std::tm t;
-  std::memset(&t, 0, sizeof(std::tm));
-  t.tm_year = GetYear() - 1900;
-  t.tm_mon = GetMonth() - 1;
-  t.tm_mday = GetDay();
-  t.tm_hour = 12;
-  t.tm_min = t.tm_sec = 0;
-  std::time_t tt = ::timegm(&t);
-  if (-1 == tt)
-  {
-    return -9999;
-  }
-
-  std::tm o;
-  std::memset(&o, 0, sizeof(std::tm));
-  o.tm_year = other.GetYear() - 1900;
-  o.tm_mon = other.GetMonth() - 1;
-  o.tm_mday = other.GetDay();
-  o.tm_hour = 12;
-  o.tm_min = o.tm_sec = 0;
-  std::time_t to = ::timegm(&o);
-  if (-1 == to)
-  {
-    return 9999;
-  }
+  return static_cast<signed long>(AsDaysSinceEpoch() - other.AsDaysSinceEpoch());
+}
 
-  return static_cast<signed long>(std::difftime(tt, to) / (60 * 60 * 24));
+UTCTime NorwegianDay::StartAsUTCTime() const
+{
+  return StartAsUTCTime(Timezone::Norway());
 }
 
+UTCTime NorwegianDay::StartAsUTCTime(const Timezone& timezone) const
+{
+  std::time_t midnight_utc = static_cast<std::time_t>(AsDaysSinceEpoch()*UTCTime::SECONDS_PER_DAY);
+  //Daylight saving changes at 0100 UTC, so for UTC+0..+2 the offset an hour or two before 0000 UTC is the offset at local midnight
+  std::time_t offset = timezone.GetOffset(midnight_utc - timezone.GetOffset(midnight_utc, GetYear()));
+  return UTCTime(midnight_utc - offset);
+}
 
-NorwegianTime::NorwegianTime(const std::tm time_tm_norwegiantime) :
-  NorwegianDay(time_tm_norwegiantime),
-  m_hour(static_cast<uint8_t>(time_tm_norwegiantime.tm_hour)),
-  m_minute(static_cast<uint8_t>(time_tm_norwegiantime.tm_min)),
-  m_second(static_cast<uint8_t>(time_tm_norwegiantime.tm_sec))
+NorwegianDay NorwegianDay::IncrementDaysCopy(const std::time_t& days) const
 {
+  int year;
+  unsigned int month, day;
+  CivilFromDays(AsDaysSinceEpoch()+days, year, month, day);
+  return NorwegianDay(static_cast<uint16_t>(year), static_cast<uint8_t>(month), static_cast<uint8_t>(day));
 }
 
+
 std::string NorwegianTime::ToString() const
 {
   return fmt::sprintf("%02u:%02u.%02u %u.%s %u", GetHour()%99, GetMinute()%99, GetSecond()%99, GetDay()%99, m_months[GetMonth()-1], GetYear()%9999);
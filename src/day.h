@@ -5,25 +5,75 @@
 #include <cstdint>
 #include <ctime>
 #include <string>
-#include <time.h>
+
+
+//Proleptic Gregorian calendar arithmetic without timegm/gmtime (Howard Hinnant's days_from_civil/civil_from_days).
+//Days are counted from 1970-01-01
+[[nodiscard]] constexpr std::int64_t DaysFromCivil(int year, unsigned int month, unsigned int day)
+{
+  year -= (month <= 2);
+  const std::int64_t era = (year >= 0 ? year : year-399) / 400;
+  const unsigned int year_of_era = static_cast<unsigned int>(year - era*400);
+  const unsigned int day_of_year = (153*(month > 2 ? month-3 : month+9) + 2)/5 + day-1;
+  const unsigned int day_of_era = year_of_era*365 + year_of_era/4 - year_of_era/100 + day_of_year;
+  return era*146097 + static_cast<std::int64_t>(day_of_era) - 719468;
+}
+
+constexpr void CivilFromDays(std::int64_t days, int& year, unsigned int& month, unsigned int& day)
+{
+  days += 719468;
+  const std::int64_t era = (days >= 0 ? days : days-146096) / 146097;
+  const unsigned int day_of_era = static_cast<unsigned int>(days - era*146097);
+  const unsigned int year_of_era = (day_of_era - day_of_era/1460 + day_of_era/36524 - day_of_era/146096) / 365;
+  const unsigned int day_of_year = day_of_era - (365*year_of_era + year_of_era/4 - year_of_era/100);
+  const unsigned int month_index = (5*day_of_year + 2)/153;
+  day = day_of_year - (153*month_index + 2)/5 + 1;
+  month = month_index < 10 ? month_index+3 : month_index-9;
+  year = static_cast<int>(static_cast<std::int64_t>(year_of_era) + era*400) + (month <= 2);
+}
+
+[[nodiscard]] constexpr unsigned int WeekdayFromDays(std::int64_t days) //0 is Sunday
+{
+  return static_cast<unsigned int>((days%7 + 11) % 7);
+}
+
+[[nodiscard]] constexpr std::int64_t FloorDiv(std::int64_t value, std::int64_t divisor)
+{
+  return (value >= 0) ? value/divisor : -((-value + divisor - 1)/divisor);
+}
+
+[[nodiscard]] constexpr unsigned int LastSundayInMonth(int year, unsigned int month)
+{
+  constexpr unsigned int days_in_month[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  unsigned int last_day = days_in_month[month-1] + ((2==month && 0==year%4 && (0!=year%100 || 0==year%400)) ? 1 : 0);
+  return last_day - WeekdayFromDays(DaysFromCivil(year, month, last_day));
+}
+
+static_assert(DaysFromCivil(1970, 1, 1) == 0);
+static_assert(DaysFromCivil(2000, 3, 1) == 11017);
+static_assert(WeekdayFromDays(0) == 4 && WeekdayFromDays(-1) == 3); //1.1.1970 was a Thursday
+static_assert(LastSundayInMonth(2022, 3) == 27 && LastSundayInMonth(2022, 10) == 30);
 
 
 class NorwegianDay;
 class NorwegianTime;
+class Timezone;
+//Just a time_t (8 bytes). Calendar fields are calculated when asked for, so copying, comparing and adding seconds is free
 class UTCTime
 {
+public:
+  static constexpr std::time_t SECONDS_PER_DAY = 24*60*60;
+
 public:
   UTCTime();
-  UTCTime(const std::time_t& time);
+  UTCTime(const std::time_t& time) : m_time_utc(time) {}
   UTCTime(const std::string& time);
-private:
-  void Initialize(const std::time_t& time);
 public:
   [[nodiscard]] bool operator<(const UTCTime& other) const {return AsUTCTimeT()<other.AsUTCTimeT();}
   [[nodiscard]] bool operator==(const UTCTime& other) const {return AsUTCTimeT()==other.AsUTCTimeT();}
   [[nodiscard]] bool operator>=(const UTCTime& other) const {return AsUTCTimeT()>=other.AsUTCTimeT();}
   [[nodiscard]] bool operator!=(const UTCTime& other) const {return AsUTCTimeT()!=other.AsUTCTimeT();}
-  [[nodiscard]] UTCTime IncrementSecondsCopy(const std::time_t& seconds) const;
+  [[nodiscard]] UTCTime IncrementSecondsCopy(const std::time_t& seconds) const {return UTCTime(m_time_utc + seconds);}
   [[nodiscard]] UTCTime IncrementHoursCopy(const std::time_t& hours) const {return IncrementSecondsCopy(hours*60*60);}
   [[nodiscard]] UTCTime IncrementNorwegianDaysCopy(const std::time_t& days) const;
   [[nodiscard]] UTCTime DecrementSecondsCopy(const std::time_t& seconds) const {return IncrementSecondsCopy(-seconds);}
@@ -31,13 +81,15 @@ public:
   [[nodiscard]] UTCTime DecrementNorwegianDaysCopy(const std::time_t& days) const {return IncrementNorwegianDaysCopy(-days);}
   [[nodiscard]] const NorwegianDay AsNorwegianDay() const;
   [[nodiscard]] const NorwegianTime AsNorwegianTime() const;
+  [[nodiscard]] const NorwegianDay AsLocalDay(const Timezone& timezone) const; //Day in another timezone than Norway. Still a NorwegianDay, as that is the calendar day type
+  [[nodiscard]] const NorwegianTime AsLocalTime(const Timezone& timezone) const;
   [[nodiscard]] std::time_t AsUTCTimeT() const {return m_time_utc;}
-  [[nodiscard]] uint16_t GetYear() const {return static_cast<uint16_t>(m_time_tm_utc.tm_year+1900);}
-  [[nodiscard]] uint8_t GetMonth() const {return static_cast<uint8_t>(m_time_tm_utc.tm_mon+1);}
-  [[nodiscard]] uint8_t GetDay() const {return static_cast<uint8_t>(m_time_tm_utc.tm_mday);}
-  [[nodiscard]] uint8_t GetHour() const {return static_cast<uint8_t>(m_time_tm_utc.tm_hour);}
-  [[nodiscard]] uint8_t GetMinute() const {return static_cast<uint8_t>(m_time_tm_utc.tm_min);}
-  [[nodiscard]] uint8_t GetSecond() const {return static_cast<uint8_t>(m_time_tm_utc.tm_sec);}
+  [[nodiscard]] uint16_t GetYear() const;
+  [[nodiscard]] uint8_t GetMonth() const;
+  [[nodiscard]] uint8_t GetDay() const;
+  [[nodiscard]] uint8_t GetHour() const {return static_cast<uint8_t>(SecondOfDay()/(60*60));}
+  [[nodiscard]] uint8_t GetMinute() const {return static_cast<uint8_t>(SecondOfDay()/60%60);}
+  [[nodiscard]] uint8_t GetSecond() const {return static_cast<uint8_t>(SecondOfDay()%60);}
   [[nodiscard]] UTCTime DaylightSavingStart() const;
   [[nodiscard]] UTCTime DaylightSavingEnd() const;
   [[nodiscard]] std::time_t GetNorwegianTimezoneOffset() const;
@@ -48,13 +100,14 @@ public:
   void SetSecond(uint8_t second);
   
 private:
-  [[nodiscard]] uint8_t LastSundayInMonth(uint16_t year, uint8_t month) const;
+  [[nodiscard]] std::int64_t DaysSinceEpoch() const {return FloorDiv(m_time_utc, SECONDS_PER_DAY);}
+  [[nodiscard]] std::time_t SecondOfDay() const {return static_cast<std::time_t>(m_time_utc - DaysSinceEpoch()*SECONDS_PER_DAY);}
 
 private:
   std::time_t m_time_utc;
-  std::tm m_time_tm_utc;
 };
 
+//Stored packed as the yyyymmdd number returned by AsULong, so it can be used as a key (and ordered) without any conversion
 class NorwegianDay
 {
 friend class UTCTime;
@@ -62,38 +115,43 @@ friend class NorwegianTime;
 private:
   static constexpr std::array<const char*, 12> m_months{"januar", "februar", "mars", "april", "mai", "juni", "juli", "august", "september", "oktober", "november", "desember"};
 private:
-  NorwegianDay(const std::tm time_tm_norwegiantime);
-  NorwegianDay(unsigned long as_ulong);
-  NorwegianDay(uint16_t year, uint8_t month, uint8_t day) : m_year(year), m_month(month), m_day(day) {}
+  NorwegianDay(uint16_t year, uint8_t month, uint8_t day) : m_day_key(static_cast<uint32_t>((year%9999)*10*10*10*10 + (month%99)*10*10 + (day%99))) {}
+public:
+  explicit NorwegianDay(unsigned long as_ulong) : m_day_key(static_cast<uint32_t>(as_ulong)) {}
 public:
   [[nodiscard]] bool operator<(const NorwegianDay& other) const {return AsULong()<other.AsULong();}
   [[nodiscard]] bool operator==(const NorwegianDay& other) const {return AsULong()==other.AsULong();}
   [[nodiscard]] bool operator!=(const NorwegianDay& other) const {return AsULong()!=other.AsULong();}
-  [[nodiscard]] unsigned long AsULong() const {return (m_year%9999)*10*10*10*10 + (m_month%99)*10*10 + (m_day%99);}
-  [[nodiscard]] virtual std::string ToString() const;
+  [[nodiscard]] unsigned long AsULong() const {return m_day_key;}
+  [[nodiscard]] std::string ToString() const;
   [[nodiscard]] bool IsToday() const;
   [[nodiscard]] bool IsTomorrow() const;
+  [[nodiscard]] static NorwegianDay Today(); //Cached. Only recalculated after Norwegian midnight
   [[nodiscard]] signed long DaysAfter(unsigned long other) const {return DaysAfter(NorwegianDay(other));}
   [[nodiscard]] signed long DaysAfter(const NorwegianDay& other) const;
-  [[nodiscard]] uint16_t GetYear() const {return m_year;}
-  [[nodiscard]] uint8_t GetMonth() const {return m_month;}
-  [[nodiscard]] uint8_t GetDay() const {return m_day;}
+  [[nodiscard]] UTCTime StartAsUTCTime() const; //Norwegian midnight, as UTC
+  [[nodiscard]] UTCTime StartAsUTCTime(const Timezone& timezone) const; //Local midnight in timezone, as UTC
+  [[nodiscard]] NorwegianDay IncrementDaysCopy(const std::time_t& days) const;
+  [[nodiscard]] std::int64_t AsDaysSinceEpoch() const {return DaysFromCivil(GetYear(), GetMonth(), GetDay());}
+  [[nodiscard]] uint16_t GetYear() const {return static_cast<uint16_t>(m_day_key/(10*10*10*10));}
+  [[nodiscard]] uint8_t GetMonth() const {return static_cast<uint8_t>(m_day_key/(10*10)%100);}
+  [[nodiscard]] uint8_t GetDay() const {return static_cast<uint8_t>(m_day_key%100);}
 private:
-  uint16_t m_year;
-  uint8_t  m_month;
-  uint8_t  m_day;
+  uint32_t m_day_key;
 };
 
+static_assert(sizeof(NorwegianDay) == sizeof(uint32_t)); //No vptr. Copied and compared as the packed key
+
 class NorwegianTime : public NorwegianDay
 {
 friend class UTCTime;
 private:
-  NorwegianTime(const std::tm time_tm_norwegiantime);
+  NorwegianTime(const NorwegianDay& day, uint8_t hour, uint8_t minute, uint8_t second) : NorwegianDay(day), m_hour(hour), m_minute(minute), m_second(second) {}
 public:
   [[nodiscard]] uint8_t GetHour() const {return m_hour;}
   [[nodiscard]] uint8_t GetMinute() const {return m_minute;}
   [[nodiscard]] uint8_t GetSecond() const {return m_second;}
-  [[nodiscard]] std::string ToString() const override;
+  [[nodiscard]] std::string ToString() const; //Hides NorwegianDay::ToString, which is not virtual
 private:
   uint8_t  m_hour;
   uint8_t  m_minute;
@@ -0,0 +1,356 @@
+#include "daypayload.h"
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <string_view>
+
+
+namespace
+{
+  void AppendJSON(std::string& out, double value, int precision)
+  {
+    std::array<char, 64> buffer;
+    std::to_chars_result result = std::to_chars(buffer.data(), buffer.data()+buffer.size(), value, std::chars_format::fixed, precision);
+    if (std::errc() != result.ec)
+    {
+      result = std::to_chars(buffer.data(), buffer.data()+buffer.size(), value, std::chars_format::scientific, precision);
+    }
+    out.append(buffer.data(), result.ptr);
+  }
+
+  void AppendJSON(std::string& out, unsigned long value, int min_digits=1)
+  {
+    std::array<char, 24> buffer;
+    std::to_chars_result result = std::to_chars(buffer.data(), buffer.data()+buffer.size(), value);
+    for (std::ptrdiff_t digits=result.ptr-buffer.data(); digits<min_digits; digits++)
+    {
+      out.push_back('0');
+    }
+    out.append(buffer.data(), result.ptr);
+  }
+
+  void AppendJSON(std::string& out, std::span<const double> values, int precision)
+  {
+    out.push_back('[');
+    for (std::size_t index=0; index<values.size(); index++)
+    {
+      if (0 < index)
+      {
+        out.push_back(',');
+      }
+      AppendJSON(out, values[index], precision);
+    }
+    out.push_back(']');
+  }
+
+  void AppendJSON(std::string& out, std::span<const unsigned int> values)
+  {
+    out.push_back('[');
+    for (std::size_t index=0; index<values.size(); index++)
+    {
+      if (0 < index)
+      {
+        out.push_back(',');
+      }
+      AppendJSON(out, static_cast<unsigned long>(values[index]));
+    }
+    out.push_back(']');
+  }
+
+  void AppendJSONKey(std::string& out, const std::string& key) //Keys are plain ascii, so no escaping
+  {
+    out.push_back('"');
+    out.append(key);
+    out.append("\":");
+  }
+
+
+  enum CBORMajorType : uint8_t
+  {
+    CBOR_UNSIGNED = 0,
+    CBOR_TEXT = 3,
+    CBOR_ARRAY = 4,
+    CBOR_MAP = 5,
+    CBOR_SIMPLE = 7
+  };
+
+  void AppendCBORHead(std::string& out, CBORMajorType major_type, uint64_t value)
+  {
+    const uint8_t major = static_cast<uint8_t>(major_type << 5);
+    int bytes;
+    if (value < 24)
+    {
+      out.push_back(static_cast<char>(major | value));
+      return;
+    }
+    else if (value <= 0xFF)
+    {
+      out.push_back(static_cast<char>(major | 24));
+      bytes = 1;
+    }
+    else if (value <= 0xFFFF)
+    {
+      out.push_back(static_cast<char>(major | 25));
+      bytes = 2;
+    }
+    else if (value <= 0xFFFFFFFF)
+    {
+      out.push_back(static_cast<char>(major | 26));
+      bytes = 4;
+    }
+    else
+    {
+      out.push_back(static_cast<char>(major | 27));
+      bytes = 8;
+    }
+    for (int byte=bytes-1; byte>=0; byte--) //Big-endian
+    {
+      out.push_back(static_cast<char>((value >> (8*byte)) & 0xFF));
+    }
+  }
+
+  void AppendCBOR(std::string& out, std::string_view text)
+  {
+    AppendCBORHead(out, CBOR_TEXT, text.size());
+    out.append(text);
+  }
+
+  void AppendCBOR(std::string& out, double value)
+  {
+    out.push_back(static_cast<char>((CBOR_SIMPLE << 5) | 27)); //Double-precision float
+    uint64_t bits = std::bit_cast<uint64_t>(value);
+    for (int byte=7; byte>=0; byte--)
+    {
+      out.push_back(static_cast<char>((bits >> (8*byte)) & 0xFF));
+    }
+  }
+
+  void AppendCBOR(std::string& out, std::span<const double> values)
+  {
+    AppendCBORHead(out, CBOR_ARRAY, values.size());
+    for (double value : values)
+    {
+      AppendCBOR(out, value);
+    }
+  }
+
+  void AppendCBOR(std::string& out, std::span<const unsigned int> values)
+  {
+    AppendCBORHead(out, CBOR_ARRAY, values.size());
+    for (unsigned int value : values)
+    {
+      AppendCBORHead(out, CBOR_UNSIGNED, value);
+    }
+  }
+
+
+  std::string_view PercentileKey(std::array<char, 8>& buffer, unsigned int percentile) //Like p10
+  {
+    buffer[0] = 'p';
+    std::to_chars_result result = std::to_chars(buffer.data()+1, buffer.data()+buffer.size(), percentile);
+    return std::string_view(buffer.data(), static_cast<std::size_t>(result.ptr - buffer.data()));
+  }
+
+  void AppendJSON(std::string& out, const PriceStatistics::Zone& statistics, int precision)
+  {
+    out.append("{\"mean\":");
+    AppendJSON(out, statistics.mean, precision);
+    out.append(",\"median\":");
+    AppendJSON(out, statistics.median, precision);
+    out.append(",\"stddev\":");
+    AppendJSON(out, statistics.standard_deviation, precision);
+    out.append(",\"min\":");
+    AppendJSON(out, statistics.min, precision);
+    out.append(",\"minslot\":");
+    AppendJSON(out, static_cast<unsigned long>(statistics.min_slot));
+    out.append(",\"max\":");
+    AppendJSON(out, statistics.max, precision);
+    out.append(",\"maxslot\":");
+    AppendJSON(out, static_cast<unsigned long>(statistics.max_slot));
+    std::array<char, 8> key_buffer;
+    for (std::size_t index=0; index<PriceStatistics::PERCENTILES.size(); index++)
+    {
+      out.append(",\"");
+      out.append(PercentileKey(key_buffer, PriceStatistics::PERCENTILES[index]));
+      out.append("\":");
+      AppendJSON(out, statistics.percentiles[index], precision);
+    }
+    out.push_back('}');
+  }
+
+  void AppendCBOR(std::string& out, const PriceStatistics::Zone& statistics)
+  {
+    AppendCBORHead(out, CBOR_MAP, 7 + PriceStatistics::PERCENTILES.size());
+    AppendCBOR(out, std::string_view("mean"));
+    AppendCBOR(out, statistics.mean);
+    AppendCBOR(out, std::string_view("median"));
+    AppendCBOR(out, statistics.median);
+    AppendCBOR(out, std::string_view("stddev"));
+    AppendCBOR(out, statistics.standard_deviation);
+    AppendCBOR(out, std::string_view("min"));
+    AppendCBOR(out, statistics.min);
+    AppendCBOR(out, std::string_view("minslot"));
+    AppendCBORHead(out, CBOR_UNSIGNED, statistics.min_slot);
+    AppendCBOR(out, std::string_view("max"));
+    AppendCBOR(out, statistics.max);
+    AppendCBOR(out, std::string_view("maxslot"));
+    AppendCBORHead(out, CBOR_UNSIGNED, statistics.max_slot);
+    std::array<char, 8> key_buffer;
+    for (std::size_t index=0; index<PriceStatistics::PERCENTILES.size(); index++)
+    {
+      AppendCBOR(out, PercentileKey(key_buffer, PriceStatistics::PERCENTILES[index]));
+      AppendCBOR(out, statistics.percentiles[index]);
+    }
+  }
+
+  void AppendJSONDay(std::string& out, const NorwegianDay& day) //"day":"yyyy-mm-dd"
+  {
+    out.append("\"day\":\"");
+    AppendJSON(out, static_cast<unsigned long>(day.GetYear()), 4);
+    out.push_back('-');
+    AppendJSON(out, static_cast<unsigned long>(day.GetMonth()), 2);
+    out.push_back('-');
+    AppendJSON(out, static_cast<unsigned long>(day.GetDay()), 2);
+    out.push_back('"');
+  }
+}
+
+
+void DayPayload::WriteJSON(std::string& out, int precision) const
+{
+  out.clear();
+  out.push_back('{');
+  AppendJSONDay(out, day);
+  out.append(",\"resolution\":");
+  AppendJSON(out, static_cast<unsigned long>(resolution_minutes));
+
+  out.append(",\"exchangerate\":{");
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    if (0 < currency_index)
+    {
+      out.push_back(',');
+    }
+    AppendJSONKey(out, currencies[currency_index]);
+    AppendJSON(out, exchange_rates[currency_index], precision);
+  }
+  out.append("},\"eur\":");
+  AppendJSON(out, eur_prices, precision);
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    out.push_back(',');
+    AppendJSONKey(out, currencies[currency_index]);
+    AppendJSON(out, currency_prices[currency_index], precision);
+  }
+  out.append(",\"order\":");
+  AppendJSON(out, order);
+  out.append(",\"sorted\":");
+  AppendJSON(out, sorted);
+  if (eur_statistics)
+  {
+    out.append(",\"stats\":{\"eur\":");
+    AppendJSON(out, *eur_statistics, precision);
+    for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+    {
+      out.push_back(',');
+      AppendJSONKey(out, currencies[currency_index]);
+      AppendJSON(out, *currency_statistics[currency_index], precision);
+    }
+    out.push_back('}');
+  }
+  out.push_back('}');
+}
+
+void DayPayload::WriteCBOR(std::string& out) const
+{
+  out.clear();
+  AppendCBORHead(out, CBOR_MAP, 6 + currencies.size() + (eur_statistics ? 1 : 0));
+  AppendCBOR(out, std::string_view("day"));
+  AppendCBORHead(out, CBOR_UNSIGNED, day.AsULong()); //yyyymmdd
+  AppendCBOR(out, std::string_view("resolution"));
+  AppendCBORHead(out, CBOR_UNSIGNED, resolution_minutes);
+
+  AppendCBOR(out, std::string_view("exchangerate"));
+  AppendCBORHead(out, CBOR_MAP, currencies.size());
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    AppendCBOR(out, currencies[currency_index]);
+    AppendCBOR(out, exchange_rates[currency_index]);
+  }
+  AppendCBOR(out, std::string_view("eur"));
+  AppendCBOR(out, eur_prices);
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    AppendCBOR(out, currencies[currency_index]);
+    AppendCBOR(out, currency_prices[currency_index]);
+  }
+  AppendCBOR(out, std::string_view("order"));
+  AppendCBOR(out, order);
+  AppendCBOR(out, std::string_view("sorted"));
+  AppendCBOR(out, sorted);
+  if (eur_statistics)
+  {
+    AppendCBOR(out, std::string_view("stats"));
+    AppendCBORHead(out, CBOR_MAP, 1 + currencies.size());
+    AppendCBOR(out, std::string_view("eur"));
+    AppendCBOR(out, *eur_statistics);
+    for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+    {
+      AppendCBOR(out, currencies[currency_index]);
+      AppendCBOR(out, *currency_statistics[currency_index]);
+    }
+  }
+}
+
+void SpreadPayload::WriteJSON(std::string& out, int precision) const
+{
+  out.clear();
+  out.push_back('{');
+  AppendJSONDay(out, day);
+  out.append(",\"resolution\":");
+  AppendJSON(out, static_cast<unsigned long>(resolution_minutes));
+  out.append(",\"mean\":{\"eur\":");
+  AppendJSON(out, eur_statistics->GetMeanSpread(), precision);
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    out.push_back(',');
+    AppendJSONKey(out, currencies[currency_index]);
+    AppendJSON(out, currency_statistics[currency_index]->GetMeanSpread(), precision);
+  }
+  out.append("},\"eur\":");
+  AppendJSON(out, eur_statistics->GetSlotSpreads(), precision);
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    out.push_back(',');
+    AppendJSONKey(out, currencies[currency_index]);
+    AppendJSON(out, currency_statistics[currency_index]->GetSlotSpreads(), precision);
+  }
+  out.push_back('}');
+}
+
+void SpreadPayload::WriteCBOR(std::string& out) const
+{
+  out.clear();
+  AppendCBORHead(out, CBOR_MAP, 4 + currencies.size());
+  AppendCBOR(out, std::string_view("day"));
+  AppendCBORHead(out, CBOR_UNSIGNED, day.AsULong()); //yyyymmdd
+  AppendCBOR(out, std::string_view("resolution"));
+  AppendCBORHead(out, CBOR_UNSIGNED, resolution_minutes);
+  AppendCBOR(out, std::string_view("mean"));
+  AppendCBORHead(out, CBOR_MAP, 1 + currencies.size());
+  AppendCBOR(out, std::string_view("eur"));
+  AppendCBOR(out, eur_statistics->GetMeanSpread());
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    AppendCBOR(out, currencies[currency_index]);
+    AppendCBOR(out, currency_statistics[currency_index]->GetMeanSpread());
+  }
+  AppendCBOR(out, std::string_view("eur"));
+  AppendCBOR(out, eur_statistics->GetSlotSpreads());
+  for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+  {
+    AppendCBOR(out, currencies[currency_index]);
+    AppendCBOR(out, currency_statistics[currency_index]->GetSlotSpreads());
+  }
+}
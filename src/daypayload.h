@@ -0,0 +1,50 @@
+#ifndef _DAYPAYLOAD_H_
+#define _DAYPAYLOAD_H_
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "day.h"
+#include "statistics.h"
+
+
+//All prices for one zone and one local delivery day, as one consolidated message:
+//  {"day":"2025-03-30","resolution":60,"exchangerate":{"nok":11.52},"eur":[...],"nok":[...],"order":[...],"sorted":[...],
+//   "stats":{"eur":{"mean":..,"median":..,"stddev":..,"min":..,"minslot":..,"max":..,"maxslot":..,"p10":..,"p25":..,"p75":..,"p90":..},"nok":{...}}}
+//CBOR (RFC 8949) holds the same map, with day as the number yyyymmdd and prices and exchange rates as full-precision doubles.
+//Written into a caller-owned string, so reusing the string keeps publishing free of allocations
+struct DayPayload
+{
+  NorwegianDay day{19700101UL};
+  unsigned int resolution_minutes = 60;
+  std::span<const std::string> currencies; //Lowercase, like nok. Used as keys
+  std::span<const double> exchange_rates; //Indexed like currencies
+  std::span<const double> eur_prices;
+  std::vector<std::span<const double>> currency_prices; //Indexed like currencies
+  std::span<const unsigned int> order; //Per slot, from most expensive (0) to least expensive
+  std::span<const unsigned int> sorted; //Slots, from most expensive to least expensive
+  const PriceStatistics::Zone* eur_statistics = nullptr; //No "stats" if nullptr
+  std::vector<const PriceStatistics::Zone*> currency_statistics; //Indexed like currencies
+
+  void WriteJSON(std::string& out, int precision) const;
+  void WriteCBOR(std::string& out) const;
+};
+
+
+//Spreads between the most expensive and the cheapest zone for one day, per slot of the first zone (compared at the same UTC time) and for the daily means:
+//  {"day":"2025-03-30","resolution":60,"mean":{"eur":12.3,"nok":141.7},"eur":[...],"nok":[...]}
+struct SpreadPayload
+{
+  NorwegianDay day{19700101UL};
+  unsigned int resolution_minutes = 60;
+  std::span<const std::string> currencies; //Lowercase, like nok. Used as keys
+  const PriceStatistics* eur_statistics = nullptr;
+  std::vector<const PriceStatistics*> currency_statistics; //Indexed like currencies
+
+  void WriteJSON(std::string& out, int precision) const;
+  void WriteCBOR(std::string& out) const;
+};
+
+#endif // _DAYPAYLOAD_H_
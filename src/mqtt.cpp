@@ -1,23 +1,100 @@
 #include "mqtt.h"
 
 #include <algorithm>
-#include <iomanip>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <limits>
 #include <sstream>
 
 #include <fmt/printf.h>
 
+#include <Poco/JSON/Array.h>
+#include <Poco/JSON/Object.h>
+#include <Poco/JSON/Parser.h>
+#include <Poco/String.h>
+
 #include "application.h"
 
 
 MQTT::MQTT()
+: m_max_inflight(static_cast<std::size_t>(std::max(::GetApp()->GetConfigInt(Elspot::MQTT_MAX_INFLIGHT_PROPERTY, DEFAULT_MAX_INFLIGHT), 1))),
+  m_batch_failed(false),
+  m_v5(::GetApp()->GetConfigBool(Elspot::MQTT_V5_PROPERTY, false)),
+  m_connection_count(0),
+  m_configured_topic_alias_maximum(static_cast<uint16_t>(std::clamp(::GetApp()->GetConfigInt(Elspot::MQTT_TOPIC_ALIAS_MAXIMUM_PROPERTY, DEFAULT_TOPIC_ALIAS_MAXIMUM), 0, 0xFFFF))),
+  m_topic_alias_maximum(m_configured_topic_alias_maximum),
+  m_alias_connection(0),
+  m_message_expires_utc(0),
+  m_session_established(false),
+  m_reconnected(false),
+  m_full_republish_seconds(static_cast<std::time_t>(std::max(::GetApp()->GetConfigInt(Elspot::MQTT_FULL_REPUBLISH_HOURS_PROPERTY, DEFAULT_FULL_REPUBLISH_HOURS), 0))*60*60),
+  m_next_full_republish(0),
+  m_force_full_republish(true),
+  m_batch_published(0),
+  m_batch_skipped(0),
+  m_legacy_topics(::GetApp()->GetConfigBool(Elspot::MQTT_LEGACY_TOPICS_PROPERTY, true)),
+  m_json_day_payloads(false),
+  m_cbor_day_payloads(false),
+  m_current_resolution_minutes(60),
+  m_optimiser(::GetApp()->GetConfigBool(Elspot::MQTT_OPTIMISER_PROPERTY, false))
 {
-  m_mqtt_client = std::make_unique<mqtt::client>(::GetApp()->GetConfig("mqtt_server"), CLIENT_ID, MAX_BUFFERED_MESSAGES);
+  const std::shared_ptr<Spotprice> spotprice = ::GetApp()->GetSpotprice();
+  const ZoneCatalogue& zones = spotprice.get() ? spotprice->GetZones() : ZoneCatalogue();
+  const std::shared_ptr<Currency> currency = ::GetApp()->GetCurrency();
+  const std::vector<std::string> currencies = currency.get() ? currency->GetCurrencies() : Currency().GetCurrencies();
+  BuildTopics(zones, currencies);
+
+  std::istringstream day_payloads(Poco::toLower(::GetApp()->GetConfig(Elspot::MQTT_DAY_PAYLOADS_PROPERTY, DEFAULT_DAY_PAYLOADS)));
+  std::string day_payload;
+  while (std::getline(day_payloads, day_payload, ','))
+  {
+    Poco::trimInPlace(day_payload);
+    if ("json" == day_payload)
+    {
+      m_json_day_payloads = true;
+    }
+    else if ("cbor" == day_payload)
+    {
+      m_cbor_day_payloads = true;
+    }
+    else if (!day_payload.empty())
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Unknown MQTT day payload format ")+day_payload);
+    }
+  }
+  //Collapsed per topic, so a queue the size of one full publish never drops anything
+  m_outbound = std::make_unique<OutboundQueue>(::GetApp()->GetConfig(Elspot::MQTT_QUEUE_FILE_PROPERTY, ""), static_cast<std::size_t>(MaxBufferedMessages(zones.size(), currencies.size())));
+  if (!m_outbound->Load())
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning("Starting with an empty MQTT outbound queue");
+  }
+  if (m_v5)
+  {
+    Poco::Logger::get(Logger::DEFAULT).information("Using MQTT v5");
+    //No offline buffer in paho. A message buffered there could be sent on a later connection with an alias the broker does not know.
+    //Publishing while disconnected throws instead, and Send queues the message, with its full topic, in m_outbound
+    m_mqtt_client = std::make_unique<mqtt::async_client>(::GetApp()->GetConfig("mqtt_server"), CLIENT_ID, mqtt::create_options(MQTTVERSION_5));
+  }
+  else
+  {
+    m_mqtt_client = std::make_unique<mqtt::async_client>(::GetApp()->GetConfig("mqtt_server"), CLIENT_ID, MaxBufferedMessages(zones.size(), currencies.size()));
+  }
 	m_mqtt_client->set_callback(*this);
 
-  auto connopts = mqtt::connect_options_builder()
-                    .clean_session(true)
-                    .keep_alive_interval(std::chrono::seconds(20))
-                    .automatic_reconnect(true);
+  //One long-lived connection. Once established, paho reconnects by itself, and connected() replays what was queued meanwhile
+  auto connopts = m_v5 ? mqtt::connect_options_builder::v5() : mqtt::connect_options_builder();
+  if (m_v5)
+  {
+    connopts.clean_start(true);
+  }
+  else
+  {
+    connopts.clean_session(true);
+  }
+  connopts.keep_alive_interval(std::chrono::seconds(20))
+          .max_inflight(static_cast<int>(m_max_inflight))
+          .automatic_reconnect(MIN_RECONNECT_DELAY, MAX_RECONNECT_DELAY);
   
   if (!::GetApp()->GetConfig("mqtt_username").empty())
   {
@@ -40,16 +117,98 @@ MQTT::MQTT()
   m_connection_options = connopts.finalize();
 }
 
+void MQTT::connected(const std::string& /*cause*/)
+{
+  Poco::Logger::get(Logger::DEFAULT).information("MQTT connected");
+  if (m_v5)
+  {
+    mqtt::token_ptr connect_token;
+    { //Lock scope
+      const std::lock_guard<std::mutex> lock(m_reconnect_mutex);
+      connect_token = m_connect_token;
+    }
+    if (connect_token)
+    {
+      UpdateTopicAliasMaximum(connect_token); //Before the new connection count makes TopicAlias start over
+    }
+  }
+  m_connection_count++;
+  m_session_established = true;
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_reconnect_mutex);
+    m_reconnected = true;
+  }
+  m_reconnect_condition.notify_all();
+
+  if (m_optimiser)
+  {
+    try
+    {
+      m_mqtt_client->subscribe(OPTIMISER_REQUEST_TOPIC, 1); //Again on every connection, as sessions are clean
+    }
+    catch (const mqtt::exception& exc)
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("MQTT could not subscribe to optimiser requests: ")+exc.get_message());
+    }
+  }
+}
+
 void MQTT::connection_lost(const std::string& cause)
 {
   Poco::Logger::get(Logger::DEFAULT).warning(std::string("MQTT Connection lost: ")+cause);
+  ForceFullRepublish(); //The broker may have restarted and lost its retained messages
+}
+
+void MQTT::message_arrived(mqtt::const_message_ptr message)
+{
+  if (!m_optimiser || OPTIMISER_REQUEST_TOPIC!=message->get_topic())
+  {
+    return;
+  }
+
+  std::string request_id, response;
+  if (!AnswerOptimiserRequest(message->get_payload_str(), request_id, response))
+  {
+    return;
+  }
+
+  //Answered on the callback thread, without waiting for delivery. QoS 0, as a device that missed the answer just asks again
+  const mqtt::properties& request_properties = message->get_properties();
+  mqtt::properties response_properties;
+  std::string response_topic;
+  if (request_properties.contains(mqtt::property::RESPONSE_TOPIC))
+  {
+    response_topic = mqtt::get<std::string>(request_properties, mqtt::property::RESPONSE_TOPIC);
+    if (request_properties.contains(mqtt::property::CORRELATION_DATA))
+    {
+      response_properties.add(mqtt::property(mqtt::property::CORRELATION_DATA, mqtt::get<std::string>(request_properties, mqtt::property::CORRELATION_DATA)));
+    }
+  }
+  else if (!request_id.empty())
+  {
+    response_topic = OPTIMISER_RESPONSE_TOPIC + request_id;
+  }
+  else
+  {
+    Poco::Logger::get(Logger::DEFAULT).information("MQTT optimiser request without id or response topic");
+    return;
+  }
+
+  try
+  {
+    m_mqtt_client->publish(m_v5 ? mqtt::make_message(response_topic, response, 0, false, response_properties) : mqtt::make_message(response_topic, response, 0, false));
+  }
+  catch (const mqtt::exception& exc)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(std::string("MQTT could not answer optimiser request: ")+exc.get_message());
+  }
 }
 
 bool MQTT::GotPrices(const NorwegianDay& norwegian_day)
 {
   try
   { //Lock scope
-    const std::lock_guard<std::mutex> lock(MQTT::m_connection_mutex);
+    const std::lock_guard<std::recursive_mutex> lock(MQTT::m_connection_mutex);
 
     bool is_today = norwegian_day.IsToday();
     if (!is_today && !norwegian_day.IsTomorrow())
@@ -59,48 +218,111 @@ bool MQTT::GotPrices(const NorwegianDay& norwegian_day)
     }
 
     Spotprice::AreaRateType area_rates;
-    double exchange_rate;
-    if (!GetInfo(norwegian_day, area_rates, exchange_rate))
+    Currency::ExchangeRates exchange_rates;
+    if (!GetInfo(norwegian_day, area_rates, exchange_rates))
     {
       Poco::Logger::get(Logger::DEFAULT).information("MQTT GotPrices failed at GetInfo");
       return false;
     }
+    std::vector<Spotprice::AreaRateType> converted_rates = Currency::Convert(area_rates, exchange_rates);
+    const std::vector<std::string>& currencies = ::GetApp()->GetCurrency()->GetCurrencies();
 
-    bool was_connected = m_mqtt_client->is_connected();
-    if (!was_connected)
+    std::shared_ptr<const PriceStatistics> eur_statistics;
+    if (!::GetApp()->GetSpotprice()->GetEurStatistics(norwegian_day, eur_statistics) || eur_statistics->GetAreaCount()!=area_rates.GetAreaCount())
     {
-      m_mqtt_client->connect(m_connection_options);
+      Poco::Logger::get(Logger::DEFAULT).information("MQTT GotPrices failed at GetEurStatistics");
+      return false;
+    }
+    m_converted_statistics.clear();
+    for (double exchange_rate : exchange_rates)
+    {
+      m_converted_statistics.push_back(eur_statistics->Converted(exchange_rate));
     }
 
-    bool status = Publish(is_today ? "nordpool/today/exchangerate" : "nordpool/tomorrow/exchangerate", exchange_rate);
+    EnsureConnected();
 
-    Spotprice::DayRateType eur_rates;
-    std::array<Price,Spotprice::HOURS_PER_DAY> sorted_prices;
-    for (std::array<Area,5>::size_type area_index=0; area_index<area_rates.size(); area_index++)
+    BeginBatch();
+    const DayTopics& day_topics = m_topics[is_today ? TODAY : TOMORROW];
+    SetMessageDay(norwegian_day, Timezone::Norway());
+    bool status = PublishInteger(day_topics.resolution, static_cast<long>(area_rates.GetResolutionMinutes()));
+    for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
     {
-      eur_rates = area_rates[area_index];
+      status &= Publish(day_topics.exchangerate[currency_index], exchange_rates[currency_index], currencies[currency_index]);
+      if (LEGACY_CURRENCY == currencies[currency_index])
+      {
+        status &= Publish(day_topics.legacy_exchangerate, exchange_rates[currency_index], currencies[currency_index]);
+      }
+    }
+
+    const ZoneCatalogue& zones = ::GetApp()->GetSpotprice()->GetZones();
+    m_day_payload.day = norwegian_day;
+    m_day_payload.resolution_minutes = area_rates.GetResolutionMinutes();
+    m_day_payload.currencies = m_currency_topics;
+    m_day_payload.exchange_rates = exchange_rates;
+    m_day_payload.currency_prices.resize(currencies.size());
+    m_day_payload.currency_statistics.resize(currencies.size());
+
+    if (m_optimiser)
+    {
+      UpdateOptimiser(norwegian_day, area_rates, exchange_rates);
+    }
+
+    std::vector<Price> sorted_prices;
+    for (std::size_t area_index=0; area_index<area_rates.GetAreaCount(); area_index++)
+    {
+      const ZoneTopics& zone_topics = day_topics.zones[area_index];
+      SetMessageDay(norwegian_day, *zones[area_index].timezone); //Prices are bucketed into the zone's own delivery day
+      std::span<const double> eur_rates = area_rates[area_index];
       CopyAndSortRates(eur_rates, sorted_prices);
+      RankRates(eur_rates, sorted_prices);
       
-      for (unsigned int index=0; index<Spotprice::HOURS_PER_DAY; index++)
+      if (m_legacy_topics)
       {
-        status &= Publish(fmt::sprintf(is_today ? "nordpool/today/%s/nok%02d" : "nordpool/tomorrow/%s/nok%02d", Spotprice::m_areas[area_index].id, index), eur_rates[index] * exchange_rate);
-        status &= Publish(fmt::sprintf(is_today ? "nordpool/today/%s/eur%02d" : "nordpool/tomorrow/%s/eur%02d", Spotprice::m_areas[area_index].id, index), eur_rates[index]);
-        status &= Publish(fmt::sprintf(is_today ? "nordpool/today/%s/order%02d" : "nordpool/tomorrow/%s/order%02d", Spotprice::m_areas[area_index].id, index),
-                fmt::sprintf("%d", std::lower_bound(sorted_prices.begin(), sorted_prices.end(), eur_rates[index], [](const Price& a, double b) {return a.price > b;}) - sorted_prices.begin()));
-        status &= Publish(fmt::sprintf(is_today ? "nordpool/today/%s/sorted%d" : "nordpool/tomorrow/%s/sorted%d", Spotprice::m_areas[area_index].id, index),
-                fmt::sprintf("%02d", sorted_prices[index].hour));
+        for (unsigned int index=0; index<eur_rates.size(); index++)
+        {
+          for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+          {
+            status &= Publish(zone_topics.currency_slots[currency_index][index], converted_rates[currency_index][area_index][index], currencies[currency_index]);
+          }
+          status &= Publish(zone_topics.eur_slots[index], eur_rates[index], EUR_CURRENCY);
+          status &= PublishInteger(zone_topics.order_slots[index], m_order[index]);
+          status &= PublishInteger(zone_topics.sorted_slots[index], m_sorted[index], 2);
+        }
       }
+
+      m_day_payload.eur_prices = eur_rates;
+      for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+      {
+        m_day_payload.currency_prices[currency_index] = converted_rates[currency_index][area_index];
+      }
+      m_day_payload.order = m_order;
+      m_day_payload.sorted = m_sorted;
+      m_day_payload.eur_statistics = &(*eur_statistics)[area_index];
+      for (std::size_t currency_index=0; currency_index<currencies.size(); currency_index++)
+      {
+        m_day_payload.currency_statistics[currency_index] = &m_converted_statistics[currency_index][area_index];
+      }
+      status &= PublishDayPayloads(zone_topics);
     }
 
+    SetMessageDay(norwegian_day, Timezone::Norway());
+    m_spread_payload.day = norwegian_day;
+    m_spread_payload.resolution_minutes = area_rates.GetResolutionMinutes();
+    m_spread_payload.currencies = m_currency_topics;
+    m_spread_payload.eur_statistics = eur_statistics.get();
+    m_spread_payload.currency_statistics.clear();
+    for (const PriceStatistics& converted_statistics : m_converted_statistics)
+    {
+      m_spread_payload.currency_statistics.push_back(&converted_statistics);
+    }
+    status &= PublishSpreadPayloads(day_topics);
+
     if (is_today)
     {
       status &= PublishCurrentPrices();
     }
     
-    if (!was_connected)
-    {
-      m_mqtt_client->disconnect();
-    }
+    status &= FinishBatch();
 
     return status;
   }
@@ -115,38 +337,70 @@ bool MQTT::PublishCurrentPrices()
 {
   try
   {
-    NorwegianTime norwegian_now = UTCTime().AsNorwegianTime();
+    //Before locking, as this may fetch
+    UTCTime now;
+    NorwegianDay norwegian_today = now.AsNorwegianDay();
     Spotprice::AreaRateType area_rates;
-    double exchange_rate;
-    if (!GetInfo(norwegian_now, area_rates, exchange_rate))
+    Currency::ExchangeRates exchange_rates;
+    if (!GetInfo(norwegian_today, area_rates, exchange_rates))
     {
       return false;
     }
+    std::vector<Spotprice::AreaRateType> converted_rates = Currency::Convert(area_rates, exchange_rates);
 
-    bool was_connected = m_mqtt_client->is_connected();
-    if (!was_connected)
-    {
-      m_mqtt_client->connect(m_connection_options);
-    }
+    const std::lock_guard<std::recursive_mutex> lock(MQTT::m_connection_mutex); //Also called from GotPrices, with the lock held
 
-    Spotprice::DayRateType eur_rates;
-    std::array<Price,Spotprice::HOURS_PER_DAY> sorted_prices;
+    EnsureConnected();
+    BeginBatch();
+
+    const ZoneCatalogue& zones = ::GetApp()->GetSpotprice()->GetZones();
+    const std::vector<std::string>& currencies = ::GetApp()->GetCurrency()->GetCurrencies();
+    std::vector<Price> sorted_prices;
+    Spotprice::AreaRateType next_day_rates; //Zones east of Norway are already on their next local day just before Norwegian midnight
+    std::vector<Spotprice::AreaRateType> next_day_converted_rates;
     bool status = true;
-    for (std::array<Area,5>::size_type area_index=0; area_index<area_rates.size(); area_index++)
+    for (std::size_t area_index=0; area_index<area_rates.GetAreaCount(); area_index++)
     {
-      eur_rates = area_rates[area_index];
+      const Timezone& timezone = *zones[area_index].timezone;
+      NorwegianDay local_today = now.AsLocalDay(timezone);
+      const Spotprice::AreaRateType* local_rates = &area_rates;
+      const std::vector<Spotprice::AreaRateType>* local_converted_rates = &converted_rates;
+      if (local_today != norwegian_today)
+      {
+        if (next_day_rates.IsEmpty())
+        {
+          //Cache only. A fetch would hold m_connection_mutex for a whole ENTSO-E request. spotprice_cron fetches the day
+          if (!::GetApp()->GetSpotprice()->HasEurRate(local_today) || !::GetApp()->GetSpotprice()->GetEurRates(local_today, next_day_rates))
+          {
+            Poco::Logger::get(Logger::DEFAULT).warning(fmt::sprintf("No current price for %s in %s yet", zones[area_index].id, local_today.ToString()));
+            status = false;
+            continue;
+          }
+          next_day_converted_rates = Currency::Convert(next_day_rates, exchange_rates); //Exchange rates for the next day are normally not known yet
+        }
+        local_rates = &next_day_rates;
+        local_converted_rates = &next_day_converted_rates;
+      }
+
+      std::time_t resolution_seconds = static_cast<std::time_t>(local_rates->GetResolutionMinutes())*60;
+      std::size_t current_slot = std::min(static_cast<std::size_t>((now.AsUTCTimeT() - local_today.StartAsUTCTime(timezone).AsUTCTimeT()) / resolution_seconds),
+                                          local_rates->GetSlotCount()-1);
+      const ZoneTopics& zone_topics = m_topics[TODAY].zones[area_index];
+      std::span<const double> eur_rates = (*local_rates)[area_index];
       CopyAndSortRates(eur_rates, sorted_prices);
+      SetMessageDay(local_today, timezone);
       
-      status &= Publish(fmt::sprintf("nordpool/today/%s/nok", Spotprice::m_areas[area_index].id), eur_rates[norwegian_now.GetHour()] * exchange_rate);
-      status &= Publish(fmt::sprintf("nordpool/today/%s/eur", Spotprice::m_areas[area_index].id), eur_rates[norwegian_now.GetHour()]);
-      status &= Publish(fmt::sprintf("nordpool/today/%s/order", Spotprice::m_areas[area_index].id),
-              fmt::sprintf("%d", std::lower_bound(sorted_prices.begin(), sorted_prices.end(), eur_rates[norwegian_now.GetHour()], [](const Price& a, double b) {return a.price > b;}) - sorted_prices.begin()));
+      for (std::size_t currency_index=0; currency_index<zone_topics.current_currency.size(); currency_index++)
+      {
+        status &= Publish(zone_topics.current_currency[currency_index], (*local_converted_rates)[currency_index][area_index][current_slot], currencies[currency_index]);
+      }
+      status &= Publish(zone_topics.current_eur, eur_rates[current_slot], EUR_CURRENCY);
+      status &= PublishInteger(zone_topics.current_order,
+              std::lower_bound(sorted_prices.begin(), sorted_prices.end(), eur_rates[current_slot], [](const Price& a, double b) {return a.price > b;}) - sorted_prices.begin());
     }
+    m_current_resolution_minutes = area_rates.GetResolutionMinutes();
     
-    if (!was_connected)
-    {
-      m_mqtt_client->disconnect();
-    }
+    status &= FinishBatch();
     
     return status;
   }
@@ -157,20 +411,574 @@ bool MQTT::PublishCurrentPrices()
   }
 }
 
-bool MQTT::Publish(const std::string& topic, const double& value, int precision)
+bool MQTT::WaitForReconnect(const std::chrono::system_clock::time_point& until)
+{
+  std::unique_lock<std::mutex> lock(m_reconnect_mutex);
+  bool reconnected = m_reconnect_condition.wait_until(lock, until, [this]() {return m_reconnected;});
+  m_reconnected = false;
+  return reconnected;
+}
+
+bool MQTT::ReplayQueue()
+{
+  try
+  {
+    const std::lock_guard<std::recursive_mutex> lock(MQTT::m_connection_mutex);
+    if (m_outbound->IsEmpty())
+    {
+      return true;
+    }
+    Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("Replaying %u queued MQTT messages", m_outbound->Size()));
+    return FinishBatch() && m_outbound->IsEmpty();
+  }
+  catch (const mqtt::exception& exc)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(exc.get_message());
+    return false;
+  }
+}
+
+void MQTT::EnsureConnected()
+{
+  //After the first connection, automatic reconnect takes over. Until then, try on every batch
+  if (m_session_established || m_mqtt_client->is_connected())
+  {
+    return;
+  }
+
+  try
+  {
+    mqtt::token_ptr connect_token = m_mqtt_client->connect(m_connection_options);
+    { //Lock scope
+      const std::lock_guard<std::mutex> lock(m_reconnect_mutex);
+      m_connect_token = connect_token;
+    }
+    if (!connect_token->wait_for(CONNECT_TIMEOUT))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning("MQTT connect timed out. Queueing messages");
+    }
+    else if (m_v5)
+    {
+      UpdateTopicAliasMaximum(connect_token); //connected() may have run before m_connect_token was set
+    }
+  }
+  catch (const mqtt::exception& exc)
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("MQTT connect failed. Queueing messages: ")+exc.get_message());
+  }
+}
+
+void MQTT::UpdateTopicAliasMaximum(const mqtt::token_ptr& connect_token)
+{
+  //Never use more topic aliases than the broker accepts. No Topic Alias Maximum in CONNACK means none
+  const mqtt::properties& server_properties = connect_token->get_connect_response().get_properties();
+  uint16_t broker_maximum = server_properties.contains(mqtt::property::TOPIC_ALIAS_MAXIMUM) ? mqtt::get<uint16_t>(server_properties, mqtt::property::TOPIC_ALIAS_MAXIMUM) : 0;
+  m_topic_alias_maximum = std::min(m_configured_topic_alias_maximum, broker_maximum);
+  Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("Using up to %u MQTT topic aliases", m_topic_alias_maximum.load()));
+}
+
+void MQTT::BuildTopics(const ZoneCatalogue& zones, const std::vector<std::string>& currencies)
+{
+  m_currency_topics = CurrencyTopics(currencies);
+  const std::vector<std::string>& currency_topics = m_currency_topics;
+  for (int day_kind=TODAY; day_kind<DAY_KIND_COUNT; day_kind++)
+  {
+    const std::string prefix = (TODAY==day_kind) ? "nordpool/today/" : "nordpool/tomorrow/";
+    DayTopics& day_topics = m_topics[static_cast<std::size_t>(day_kind)];
+    day_topics.resolution = prefix + "resolution";
+    day_topics.legacy_exchangerate = prefix + "exchangerate";
+    day_topics.exchangerate.clear();
+    for (const std::string& currency : currencies)
+    {
+      day_topics.exchangerate.push_back(prefix + "exchangerate/" + currency);
+    }
+    day_topics.spread_json = prefix + "spread/json";
+    day_topics.spread_cbor = prefix + "spread/cbor";
+
+    day_topics.zones.assign(zones.size(), ZoneTopics());
+    for (std::size_t area_index=0; area_index<zones.size(); area_index++)
+    {
+      const std::string zone_prefix = prefix + zones[area_index].id + "/";
+      ZoneTopics& zone_topics = day_topics.zones[area_index];
+      if (TODAY == day_kind)
+      {
+        for (const std::string& currency_topic : currency_topics)
+        {
+          zone_topics.current_currency.push_back(zone_prefix + currency_topic);
+        }
+        zone_topics.current_eur = zone_prefix + "eur";
+        zone_topics.current_order = zone_prefix + "order";
+      }
+      zone_topics.json = zone_prefix + "json";
+      zone_topics.cbor = zone_prefix + "cbor";
+
+      zone_topics.currency_slots.resize(currency_topics.size());
+      for (unsigned int slot=0; slot<PriceSeries::MAX_SLOTS_PER_DAY; slot++)
+      {
+        for (std::size_t currency_index=0; currency_index<currency_topics.size(); currency_index++)
+        {
+          zone_topics.currency_slots[currency_index].push_back(fmt::sprintf("%s%s%02d", zone_prefix, currency_topics[currency_index], slot));
+        }
+        zone_topics.eur_slots.push_back(fmt::sprintf("%seur%02d", zone_prefix, slot));
+        zone_topics.order_slots.push_back(fmt::sprintf("%sorder%02d", zone_prefix, slot));
+        zone_topics.sorted_slots.push_back(fmt::sprintf("%ssorted%d", zone_prefix, slot));
+      }
+    }
+  }
+}
+
+bool MQTT::PublishDayPayloads(const ZoneTopics& zone_topics)
 {
-  std::string value_str;
-  return Publish(topic, DoubleToString(value, precision));
+  bool status = true;
+  if (m_json_day_payloads)
+  {
+    m_day_payload.WriteJSON(m_day_payload_buffer, PRICE_PRECISION);
+    status &= Publish(zone_topics.json, m_day_payload_buffer);
+  }
+  if (m_cbor_day_payloads)
+  {
+    m_day_payload.WriteCBOR(m_day_payload_buffer);
+    status &= Publish(zone_topics.cbor, m_day_payload_buffer);
+  }
+  return status;
 }
 
-bool MQTT::Publish(const std::string& topic, const std::string& value)
+bool MQTT::PublishSpreadPayloads(const DayTopics& day_topics)
 {
-  auto msg = mqtt::make_message(topic, value, mqtt::message::DFLT_QOS, true);
-  m_mqtt_client->publish(msg);
+  bool status = true;
+  if (m_json_day_payloads)
+  {
+    m_spread_payload.WriteJSON(m_day_payload_buffer, PRICE_PRECISION);
+    status &= Publish(day_topics.spread_json, m_day_payload_buffer);
+  }
+  if (m_cbor_day_payloads)
+  {
+    m_spread_payload.WriteCBOR(m_day_payload_buffer);
+    status &= Publish(day_topics.spread_cbor, m_day_payload_buffer);
+  }
+  return status;
+}
+
+bool MQTT::RestorePrices(const NorwegianDay& norwegian_day)
+{
+  if (!m_optimiser)
+  {
+    return true;
+  }
+
+  //Only from the cache. A day that is not cached is fetched and published again by spotprice_cron, which calls GotPrices
+  Spotprice::AreaRateType area_rates;
+  Currency::ExchangeRates exchange_rates;
+  if (!::GetApp()->GetSpotprice()->HasEurRate(norwegian_day) || !GetInfo(norwegian_day, area_rates, exchange_rates))
+  {
+    return false;
+  }
+  UpdateOptimiser(norwegian_day, area_rates, exchange_rates);
   return true;
 }
 
-bool MQTT::GetInfo(const NorwegianDay& norwegian_day, Spotprice::AreaRateType& area_rates, double& exchange_rate) const
+void MQTT::UpdateOptimiser(const NorwegianDay& norwegian_day, const Spotprice::AreaRateType& area_rates, const Currency::ExchangeRates& exchange_rates)
+{
+  std::shared_ptr<OptimiserDay> optimiser_day = std::make_shared<OptimiserDay>();
+  optimiser_day->resolution_minutes = area_rates.GetResolutionMinutes();
+  optimiser_day->exchange_rates = exchange_rates;
+  for (std::size_t area_index=0; area_index<area_rates.GetAreaCount(); area_index++)
+  {
+    optimiser_day->zones.emplace_back(area_rates[area_index]);
+  }
+
+  const std::lock_guard<std::mutex> lock(m_optimiser_mutex);
+  m_optimiser_days[norwegian_day.AsULong()] = std::move(optimiser_day);
+  m_optimiser_days.erase(m_optimiser_days.begin(), m_optimiser_days.lower_bound(NorwegianDay::Today().AsULong())); //Past days
+}
+
+/* Request, as JSON:
+ *   {"id":"dishwasher-1", "zone":"NO-1", "day":"tomorrow", "query":"window", "slots":8, "from":0, "before":96, "currency":"nok"}
+ *   id       : Letters, digits, '-', '_' and '.'. Answered on nordpool/optimiser/response/<id> (or the MQTT v5 response topic)
+ *   day      : today (default) or tomorrow. Only days published by GotPrices (or before a restart) are answered
+ *   query    : window  - the cheapest <slots> contiguous slots
+ *              cheapest - the cheapest <slots> slots, in any order
+ *              load    - when to run "profile":[energy in kWh per slot, ...], contiguous unless "interruptible":true
+ *   from     : First slot to consider. Default 0
+ *   before   : Slots from here on are not considered. Default is the end of the day
+ *   currency : Currency of the cost. Default eur
+ * Answer:
+ *   {"id":"dishwasher-1","day":"2025-03-30","zone":"NO-1","resolution":15,"currency":"nok","cost":12.34,"slots":[52,53,...]}
+ *   {"id":"dishwasher-1","error":"No prices for the day"}
+ */
+bool MQTT::AnswerOptimiserRequest(const std::string& request, std::string& request_id, std::string& response) const
+{
+  auto error = [&request_id, &response](const std::string& message)
+    {
+      response = "{\"id\":\"" + request_id + "\",\"error\":\"" + message + "\"}";
+      return true;
+    };
+
+  Poco::JSON::Object::Ptr object;
+  try
+  {
+    Poco::JSON::Parser parser;
+    object = parser.parse(request).extract<Poco::JSON::Object::Ptr>();
+    request_id = object->optValue<std::string>("id", "");
+  }
+  catch (const Poco::Exception& ex)
+  {
+    Poco::Logger::get(Logger::DEFAULT).information(std::string("MQTT optimiser request is not a JSON object: ")+ex.message());
+    return false;
+  }
+  if (MAX_REQUEST_ID_LENGTH<request_id.size() ||
+      !std::all_of(request_id.begin(), request_id.end(), [](char c) {return std::isalnum(static_cast<unsigned char>(c)) || '-'==c || '_'==c || '.'==c;}))
+  {
+    Poco::Logger::get(Logger::DEFAULT).information("MQTT optimiser request with invalid id");
+    return false; //Can not be used in a topic, or echoed without escaping
+  }
+
+  try
+  {
+    const std::string day_name = object->optValue<std::string>("day", "today");
+    if ("today"!=day_name && "tomorrow"!=day_name)
+    {
+      return error("day must be today or tomorrow");
+    }
+    const NorwegianDay day = ("today"==day_name) ? NorwegianDay::Today() : NorwegianDay::Today().IncrementDaysCopy(1);
+
+    std::shared_ptr<const OptimiserDay> optimiser_day;
+    { //Lock scope
+      const std::lock_guard<std::mutex> lock(m_optimiser_mutex);
+      auto found = m_optimiser_days.find(day.AsULong());
+      if (found != m_optimiser_days.end())
+      {
+        optimiser_day = found->second;
+      }
+    }
+    if (!optimiser_day)
+    {
+      return error("No prices for the day");
+    }
+
+    const ZoneCatalogue& zones = ::GetApp()->GetSpotprice()->GetZones();
+    const std::string zone_id = object->optValue<std::string>("zone", "");
+    std::size_t area_index = 0;
+    while (area_index<zones.size() && zones[area_index].id!=zone_id)
+    {
+      area_index++;
+    }
+    if (area_index>=zones.size() || area_index>=optimiser_day->zones.size())
+    {
+      return error("Unknown zone");
+    }
+    const Optimiser& optimiser = optimiser_day->zones[area_index];
+
+    const std::string currency = Poco::toLower(object->optValue<std::string>("currency", "eur"));
+    double exchange_rate = 1.0;
+    if ("eur" != currency)
+    {
+      auto currency_topic = std::find(m_currency_topics.begin(), m_currency_topics.end(), currency);
+      if (currency_topic==m_currency_topics.end() || static_cast<std::size_t>(currency_topic-m_currency_topics.begin())>=optimiser_day->exchange_rates.size())
+      {
+        return error("Unknown currency");
+      }
+      exchange_rate = optimiser_day->exchange_rates[static_cast<std::size_t>(currency_topic-m_currency_topics.begin())];
+    }
+
+    const int from = object->optValue<int>("from", 0);
+    const int before = object->optValue<int>("before", static_cast<int>(optimiser.GetSlotCount()));
+    const int slots = object->optValue<int>("slots", 1);
+    if (from<0 || before<0 || slots<0)
+    {
+      return error("from, before and slots can not be negative");
+    }
+    const std::size_t first_slot = static_cast<std::size_t>(from);
+    const std::size_t end_slot = std::min(static_cast<std::size_t>(before), optimiser.GetSlotCount());
+
+    Optimiser::Plan plan;
+    bool planned;
+    const std::string query = object->optValue<std::string>("query", "");
+    if ("window" == query)
+    {
+      planned = optimiser.CheapestWindow(static_cast<std::size_t>(slots), first_slot, end_slot, plan);
+    }
+    else if ("cheapest" == query)
+    {
+      planned = optimiser.CheapestSlots(static_cast<std::size_t>(slots), first_slot, end_slot, plan);
+    }
+    else if ("load" == query)
+    {
+      Poco::JSON::Array::Ptr profile_array = object->getArray("profile");
+      if (profile_array.isNull() || PriceSeries::MAX_SLOTS_PER_DAY<profile_array->size())
+      {
+        return error("load needs a profile");
+      }
+      std::vector<double> profile(profile_array->size());
+      for (std::size_t index=0; index<profile.size(); index++)
+      {
+        profile[index] = profile_array->getElement<double>(static_cast<unsigned int>(index));
+      }
+      planned = optimiser.ScheduleLoad(profile, object->optValue<bool>("interruptible", false), first_slot, end_slot, plan);
+    }
+    else
+    {
+      return error("query must be window, cheapest or load");
+    }
+    if (!planned)
+    {
+      return error("Does not fit between from and before");
+    }
+
+    response = fmt::sprintf("{\"id\":\"%s\",\"day\":\"%04u-%02u-%02u\",\"zone\":\"%s\",\"resolution\":%u,\"currency\":\"%s\",\"cost\":%s,\"slots\":[",
+                            request_id, day.GetYear(), day.GetMonth(), day.GetDay(), zone_id, optimiser_day->resolution_minutes, currency,
+                            DoubleToString(plan.cost*exchange_rate, PRICE_PRECISION));
+    for (std::size_t index=0; index<plan.slots.size(); index++)
+    {
+      if (0 < index)
+      {
+        response.push_back(',');
+      }
+      response.append(std::to_string(plan.slots[index]));
+    }
+    response.append("]}");
+    return true;
+  }
+  catch (const Poco::Exception&)
+  {
+    return error("Malformed request");
+  }
+}
+
+void MQTT::SetMessageDay(const NorwegianDay& day, const Timezone& timezone)
+{
+  m_message_expires_utc = day.IncrementDaysCopy(1).StartAsUTCTime(timezone).AsUTCTimeT();
+  if (m_v5)
+  {
+    m_message_day = fmt::sprintf("%04u-%02u-%02u", day.GetYear(), day.GetMonth(), day.GetDay());
+  }
+}
+
+bool MQTT::Publish(const std::string& topic, double value, std::string_view currency)
+{
+  return Publish(topic, FormatDouble(value, PRICE_PRECISION, m_payload_buffer), currency);
+}
+
+bool MQTT::PublishInteger(const std::string& topic, long value, int min_digits)
+{
+  //Same as "%0<min_digits>d" for non-negative values
+  char* first = m_payload_buffer.data();
+  char* last = m_payload_buffer.data() + m_payload_buffer.size();
+  std::to_chars_result result = std::to_chars(first, last, value);
+  std::ptrdiff_t padding = min_digits - (result.ptr - first);
+  if (0 <= value && 0 < padding)
+  {
+    std::memmove(first + padding, first, static_cast<std::size_t>(result.ptr - first));
+    std::fill_n(first, padding, '0');
+    result.ptr += padding;
+  }
+  return Publish(topic, std::string_view(first, static_cast<std::size_t>(result.ptr - first)));
+}
+
+bool MQTT::Publish(const std::string& topic, std::string_view value, std::string_view currency)
+{
+  //Retained topics the broker already holds with the same payload (and expiry) are skipped
+  auto acked = m_acked_payloads.find(&topic);
+  if (acked != m_acked_payloads.end() && acked->second.payload == value && acked->second.expires_utc == m_message_expires_utc)
+  {
+    m_batch_skipped++;
+    return true;
+  }
+
+  //While the broker is away, or older messages are still waiting, queue behind them to keep the order
+  if (!m_outbound->IsEmpty() || !m_mqtt_client->is_connected())
+  {
+    m_acked_payloads.erase(&topic); //The broker ends up with the queued value
+    Enqueue(topic, value, m_message_expires_utc);
+    return true;
+  }
+
+  Send(&topic, topic, value, {m_message_expires_utc, m_message_day, currency});
+  return true;
+}
+
+void MQTT::Send(const std::string* acked_topic, const std::string& topic, std::string_view value, const MessageProperties& properties)
+{
+  //Keep up to m_max_inflight messages on the wire, and only wait when the window is full
+  if (m_inflight.size() >= m_max_inflight)
+  {
+    WaitForOldest();
+  }
+
+  uint16_t announced_alias = 0;
+  mqtt::message_ptr msg = m_v5 ? MakeV5Message(acked_topic, topic, value, properties, announced_alias)
+                               : mqtt::make_message(topic, value.data(), value.size(), mqtt::message::DFLT_QOS, true); //Payload is copied into the message
+  try
+  {
+    m_inflight.push_back({m_mqtt_client->publish(msg), acked_topic, std::string(value), properties.expires_utc, announced_alias, m_alias_connection});
+  }
+  catch (const mqtt::exception& exc)
+  {
+    //Disconnected since Publish checked. Replayed with its full topic after reconnect
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("MQTT publish failed, queued for replay: ")+exc.get_message());
+    Enqueue(topic, value, properties.expires_utc);
+    return;
+  }
+  m_batch_published++;
+}
+
+mqtt::message_ptr MQTT::MakeV5Message(const std::string* acked_topic, const std::string& topic, std::string_view value, const MessageProperties& message_properties, uint16_t& announced_alias)
+{
+  mqtt::properties properties;
+  if (0 != message_properties.expires_utc)
+  {
+    std::time_t remaining = std::max<std::time_t>(message_properties.expires_utc - UTCTime().AsUTCTimeT(), 1);
+    properties.add(mqtt::property(mqtt::property::MESSAGE_EXPIRY_INTERVAL, static_cast<int>(std::min<std::time_t>(remaining, std::numeric_limits<int>::max()))));
+  }
+  if (!message_properties.day.empty())
+  {
+    properties.add(mqtt::property(mqtt::property::USER_PROPERTY, "day", std::string(message_properties.day)));
+  }
+  if (!message_properties.currency.empty())
+  {
+    properties.add(mqtt::property(mqtt::property::USER_PROPERTY, "currency", std::string(message_properties.currency)));
+  }
+
+  //Messages carry the topic with the alias until one of them is delivered on this connection (see WaitForOldest), later ones only the alias.
+  //Replayed messages are rare, and sent without
+  bool alias_only = false;
+  uint16_t alias = acked_topic ? TopicAlias(*acked_topic) : 0;
+  if (0 != alias)
+  {
+    properties.add(mqtt::property(mqtt::property::TOPIC_ALIAS, alias));
+    alias_only = m_alias_announced[alias];
+    announced_alias = alias_only ? 0 : alias;
+  }
+
+  return mqtt::message_ptr_builder()
+           .topic(alias_only ? std::string() : topic)
+           .payload(mqtt::binary_ref(value.data(), value.size()))
+           .qos(mqtt::message::DFLT_QOS)
+           .retained(true)
+           .properties(properties)
+           .finalize();
+}
+
+uint16_t MQTT::TopicAlias(const std::string& topic)
+{
+  unsigned int connection = m_connection_count;
+  if (connection != m_alias_connection)
+  {
+    //New connection, so the broker knows no aliases. Current prices are published every slot, so they get theirs first
+    m_alias_connection = connection;
+    m_topic_aliases.clear();
+    m_alias_announced.assign(static_cast<std::size_t>(m_topic_alias_maximum)+1, false);
+    for (const ZoneTopics& zone_topics : m_topics[TODAY].zones)
+    {
+      for (const std::string& current_topic : zone_topics.current_currency)
+      {
+        (void)AssignAlias(current_topic);
+      }
+      (void)AssignAlias(zone_topics.current_eur);
+      (void)AssignAlias(zone_topics.current_order);
+    }
+  }
+
+  auto alias = m_topic_aliases.find(&topic);
+  return (alias != m_topic_aliases.end()) ? alias->second : AssignAlias(topic);
+}
+
+uint16_t MQTT::AssignAlias(const std::string& topic)
+{
+  //Aliases run from 1 to m_alias_announced.size()-1
+  if (m_topic_aliases.size()+1 >= m_alias_announced.size())
+  {
+    return 0;
+  }
+  uint16_t alias = static_cast<uint16_t>(m_topic_aliases.size()+1);
+  m_topic_aliases[&topic] = alias;
+  return alias;
+}
+
+void MQTT::Enqueue(const std::string& topic, std::string_view value, std::time_t expires_utc)
+{
+  if (!m_outbound->Push(topic, value, expires_utc))
+  {
+    m_batch_failed = true; //Dropped the oldest queued message
+  }
+}
+
+bool MQTT::FinishBatch()
+{
+  //Send what is queued, oldest first, for as long as the connection lasts
+  OutboundQueue::Message message;
+  std::time_t now = UTCTime().AsUTCTimeT();
+  while (m_mqtt_client->is_connected() && m_outbound->PopFront(message))
+  {
+    if (0 == message.expires_utc || now < message.expires_utc) //Never replay prices for a delivery day that has ended
+    {
+      Send(nullptr, message.topic, message.payload, {message.expires_utc, {}, {}});
+    }
+  }
+
+  bool status = CompleteBatch();
+  (void)m_outbound->Save(); //Logs any error. Queued messages are still replayed from memory
+  return status;
+}
+
+void MQTT::BeginBatch()
+{
+  std::time_t now = UTCTime().AsUTCTimeT();
+  if (m_force_full_republish.exchange(false) || 0 == m_full_republish_seconds || now >= m_next_full_republish)
+  {
+    m_acked_payloads.clear();
+    m_next_full_republish = now + m_full_republish_seconds;
+  }
+}
+
+void MQTT::WaitForOldest()
+{
+  try
+  {
+    InFlight& oldest = m_inflight.front();
+    oldest.token->wait();
+    if (0!=oldest.announced_alias && oldest.alias_connection==m_alias_connection && m_alias_connection==m_connection_count)
+    {
+      m_alias_announced[oldest.announced_alias] = true; //The broker knows the alias on this connection
+    }
+    if (oldest.topic)
+    {
+      AckedPayload& acked = m_acked_payloads[oldest.topic];
+      acked.payload.swap(oldest.payload);
+      acked.expires_utc = oldest.expires_utc;
+    }
+  }
+  catch (const mqtt::exception& exc)
+  {
+    //Most likely the connection dropped. Queue it again, so it is replayed after reconnect
+    InFlight& oldest = m_inflight.front();
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("MQTT publish failed, queued for replay: ")+exc.get_message());
+    m_acked_payloads.erase(oldest.topic);
+    Enqueue(oldest.topic ? *oldest.topic : oldest.token->get_message()->get_topic(), oldest.payload, oldest.expires_utc); //Aliased messages have no topic of their own
+  }
+  m_inflight.pop_front();
+}
+
+bool MQTT::CompleteBatch()
+{
+  while (!m_inflight.empty())
+  {
+    WaitForOldest();
+  }
+
+  if (0 < m_batch_published+m_batch_skipped)
+  {
+    Poco::Logger::get(Logger::DEFAULT).debug(fmt::sprintf("MQTT published %u topics, skipped %u unchanged", m_batch_published, m_batch_skipped));
+  }
+  m_batch_published = 0;
+  m_batch_skipped = 0;
+
+  bool status = !m_batch_failed;
+  m_batch_failed = false;
+  return status;
+}
+
+bool MQTT::GetInfo(const NorwegianDay& norwegian_day, Spotprice::AreaRateType& area_rates, Currency::ExchangeRates& exchange_rates) const
 {
   if (!::GetApp()->GetSpotprice()->GetEurRates(norwegian_day, area_rates))
   {
@@ -178,7 +986,7 @@ bool MQTT::GetInfo(const NorwegianDay& norwegian_day, Spotprice::AreaRateType& a
     return false;
   }
 
-  if (!::GetApp()->GetCurrency()->GetExchangeRate(norwegian_day, exchange_rate))
+  if (!::GetApp()->GetCurrency()->GetExchangeRates(norwegian_day, exchange_rates))
   {
     Poco::Logger::get(Logger::DEFAULT).error(std::string("Failed to get exchange rate for ") + norwegian_day.ToString());
     return false;
@@ -187,22 +995,52 @@ bool MQTT::GetInfo(const NorwegianDay& norwegian_day, Spotprice::AreaRateType& a
   return true;
 }
 
-void MQTT::CopyAndSortRates(const Spotprice::DayRateType& eur_rates, std::array<Price,Spotprice::HOURS_PER_DAY>& sorted_prices) const
+std::vector<std::string> MQTT::CurrencyTopics(const std::vector<std::string>& currencies)
+{
+  std::vector<std::string> currency_topics;
+  for (const std::string& currency : currencies)
+  {
+    currency_topics.push_back(Poco::toLower(currency));
+  }
+  return currency_topics;
+}
+
+void MQTT::RankRates(std::span<const double> eur_rates, const std::vector<Price>& sorted_prices)
+{
+  m_order.resize(eur_rates.size());
+  m_sorted.resize(eur_rates.size());
+  for (std::size_t index=0; index<eur_rates.size(); index++)
+  {
+    m_order[index] = static_cast<unsigned int>(std::lower_bound(sorted_prices.begin(), sorted_prices.end(), eur_rates[index], [](const Price& a, double b) {return a.price > b;}) - sorted_prices.begin());
+    m_sorted[index] = sorted_prices[index].slot;
+  }
+}
+
+void MQTT::CopyAndSortRates(std::span<const double> eur_rates, std::vector<Price>& sorted_prices) const
 {
   //Copy and sort
-  for (unsigned int hour=0; hour<Spotprice::HOURS_PER_DAY; hour++)
+  sorted_prices.resize(eur_rates.size());
+  for (unsigned int slot=0; slot<eur_rates.size(); slot++)
   {
-    sorted_prices[hour].hour = hour;
-    sorted_prices[hour].price = eur_rates[hour];
+    sorted_prices[slot].slot = slot;
+    sorted_prices[slot].price = eur_rates[slot];
   }
   std::sort(sorted_prices.begin(), sorted_prices.end(), [](const Price& a, const Price& b) {return a.price > b.price;});
 }
 
 std::string MQTT::DoubleToString(const double& value, int precision)
 {
-  std::ostringstream stream;
-  stream << std::fixed;
-  stream << std::setprecision(precision);
-  stream << value;
-  return stream.str();
+  std::array<char, 64> buffer;
+  return std::string(FormatDouble(value, precision, buffer));
+}
+
+std::string_view MQTT::FormatDouble(double value, int precision, std::span<char> buffer)
+{
+  std::to_chars_result result = std::to_chars(buffer.data(), buffer.data()+buffer.size(), value, std::chars_format::fixed, precision);
+  if (std::errc() != result.ec)
+  {
+    //Too many digits in fixed notation for the buffer. Not a price
+    result = std::to_chars(buffer.data(), buffer.data()+buffer.size(), value, std::chars_format::scientific, precision);
+  }
+  return std::string_view(buffer.data(), static_cast<std::size_t>(result.ptr - buffer.data()));
 }
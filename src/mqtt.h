@@ -1,34 +1,69 @@
 #ifndef _MQTT_H_
 #define _MQTT_H_
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <span>
 #include <string>
-#include <mqtt/client.h>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <mqtt/async_client.h>
 
+#include "currency.h"
+#include "daypayload.h"
+#include "outboundqueue.h"
 #include "day.h"
+#include "optimiser.h"
 #include "spotprice.h"
 
 
 #if 0
-(<sone> is "NO-1", "NO-2", "NO-3", "NO-4" or "NO-5")
+(<sone> is a configured bidding zone id, like "NO-1" or "SE-3". See zones.cpp)
+(<CUR> is a configured currency, like "NOK" or "SEK". <cur> is the same in lowercase)
+(<slot> counts <resolution> periods from Norwegian midnight. With PT60M, [00]-[23] (or [22]/[24] on days with 23/25 hours). With PT15M, [00]-[95])
 
-nordpool/today/exchangerate               : Exchangerate used for EUR-NOK. Set to NOK for 1EUR
-nordpool/today/<sone>/nok                 : Current price in NOK. Set to NOK/KWh
+nordpool/today/exchangerate               : Exchangerate used for EUR-NOK, if NOK is configured. Set to NOK for 1EUR
+nordpool/today/exchangerate/<CUR>         : Exchangerate used for EUR-<CUR>. Set to <CUR> for 1EUR
+nordpool/today/resolution                 : Minutes per slot. Set to 15 or 60
+nordpool/today/<sone>/<cur>               : Current price in <cur>, like nok or sek. Set to <CUR>/KWh
 nordpool/today/<sone>/eur                 : Current price in EUR. Set to EUR/KWh
-nordpool/today/<sone>/order               : Current order, from most expensive (0) to least expensive (23). Set to 0-23
-nordpool/today/<sone>/nok<[00]-[23]>      : Price in NOK for a given hour. Set to NOK/KWh
-nordpool/today/<sone>/eur<[00]-[23]>      : Price in EUR for a given hour. Set to EUR/KWh
-nordpool/today/<sone>/order[00]-[23]>     : Order for a given hour, from most expensive (0) to least expensive (23). Set to 0-23
-nordpool/today/<sone>/sorted<[0]-[23]>    : Hour reference from the most expensive (0) to least expensive (23). Set to 00-23
-nordpool/tomorrow/exchangerate            : Exchangerate used for EUR-NOK. Set to NOK for 1EUR
-nordpool/tomorrow/<sone>/nok<[00]-[23]>   : Price in NOK for a given hour. Set to NOK/KWh
-nordpool/tomorrow/<sone>/eur<[00]-[23]>   : Price in EUR for a given hour. Set to EUR/KWh
-nordpool/tomorrow/<sone>/order[00]-[23]>  : Order for a given hour, from most expensive (0) to least expensive (23). Set to 0-23
-nordpool/tomorrow/<sone>/sorted<[0]-[23]> : Hour reference from the most expensive (0) to least expensive (23). Set to 00-23
+nordpool/today/<sone>/order               : Current order, from most expensive (0) to least expensive. Set to 0-<last slot>
+nordpool/today/<sone>/<cur><slot>         : Price in <cur> for a given slot. Set to <CUR>/KWh
+nordpool/today/<sone>/eur<slot>           : Price in EUR for a given slot. Set to EUR/KWh
+nordpool/today/<sone>/order<slot>         : Order for a given slot, from most expensive (0) to least expensive. Set to 0-<last slot>
+nordpool/today/<sone>/sorted<[0]-[n]>     : Slot reference from the most expensive (0) to least expensive. Set to 00-<last slot>
+nordpool/today/<sone>/json                : All of the above for the whole day in one message, with daily statistics. See daypayload.h
+nordpool/today/<sone>/cbor                : Same as json, in CBOR
+nordpool/today/spread/json                : Price difference between the most expensive and the cheapest zone, per slot and for the daily mean
+nordpool/today/spread/cbor                : Same as json, in CBOR
+nordpool/tomorrow/exchangerate            : Exchangerate used for EUR-NOK, if NOK is configured. Set to NOK for 1EUR
+nordpool/tomorrow/exchangerate/<CUR>      : Exchangerate used for EUR-<CUR>. Set to <CUR> for 1EUR
+nordpool/tomorrow/resolution              : Minutes per slot. Set to 15 or 60
+nordpool/tomorrow/<sone>/<cur><slot>      : Price in <cur> for a given slot. Set to <CUR>/KWh
+nordpool/tomorrow/<sone>/eur<slot>        : Price in EUR for a given slot. Set to EUR/KWh
+nordpool/tomorrow/<sone>/order<slot>      : Order for a given slot, from most expensive (0) to least expensive. Set to 0-<last slot>
+nordpool/tomorrow/<sone>/sorted<[0]-[n]>  : Slot reference from the most expensive (0) to least expensive. Set to 00-<last slot>
+nordpool/tomorrow/<sone>/json             : All of the above for the whole day in one message, with daily statistics. See daypayload.h
+nordpool/tomorrow/<sone>/cbor             : Same as json, in CBOR
+nordpool/tomorrow/spread/json             : Price difference between the most expensive and the cheapest zone, per slot and for the daily mean
+nordpool/tomorrow/spread/cbor             : Same as json, in CBOR
+
+nordpool/optimiser/request                : Scheduling questions from devices, if mqtt_optimiser=true. See AnswerOptimiserRequest
+nordpool/optimiser/response/<id>          : Answer to the request with the given id, unless the request had an MQTT v5 response topic
+
+(mqtt_day_payloads selects json, cbor or both. mqtt_legacy_topics=false drops the per-slot <cur><slot>, eur<slot>, order<slot> and sorted<n> topics)
+(With mqtt_v5=true, messages expire at the end of their delivery day, and carry the user properties "day" (yyyy-mm-dd) and "currency" where it applies)
 #endif
 
 struct Price
 {
-  unsigned int hour;
+  unsigned int slot;
   double price;
 };
 
@@ -37,33 +72,179 @@ class MQTT : public virtual mqtt::callback
 {
 public:
   static constexpr const char* CLIENT_ID = "elspot";
-  static constexpr int MAX_BUFFERED_MESSAGES = 4 + 4*24 + 1 + 4*24; //One message pr MQTT topic (as documented above)
+  static constexpr const char* LEGACY_CURRENCY = "NOK"; //Also published as nordpool/<day>/exchangerate
+  static constexpr int DEFAULT_MAX_INFLIGHT = 100; //Messages published but not yet completed
+  static constexpr std::chrono::seconds CONNECT_TIMEOUT = std::chrono::seconds(30);
+  static constexpr std::chrono::seconds MIN_RECONNECT_DELAY = std::chrono::seconds(1);
+  static constexpr std::chrono::seconds MAX_RECONNECT_DELAY = std::chrono::seconds(64);
+  static constexpr const char* DEFAULT_DAY_PAYLOADS = "json"; //Comma-separated, json and/or cbor
+  static constexpr int PRICE_PRECISION = 2; //Decimals in prices and exchange rates
+  static constexpr int DEFAULT_TOPIC_ALIAS_MAXIMUM = 1000; //MQTT v5. Lowered to what the broker accepts
+  static constexpr std::string_view EUR_CURRENCY = "EUR";
+  static constexpr const char* OPTIMISER_REQUEST_TOPIC = "nordpool/optimiser/request";
+  static constexpr const char* OPTIMISER_RESPONSE_TOPIC = "nordpool/optimiser/response/"; //Followed by the request id
+  static constexpr std::size_t MAX_REQUEST_ID_LENGTH = 64;
+  static constexpr int DEFAULT_FULL_REPUBLISH_HOURS = 24; //Unchanged retained topics are republished this often anyway. 0 always republishes everything
+  [[nodiscard]] static constexpr int MaxBufferedMessages(std::size_t area_count, std::size_t currency_count) //One message pr MQTT topic (as documented above)
+    {return static_cast<int>(2*(2 + currency_count + 2) + area_count*((2 + currency_count) + 2*((3 + currency_count)*PriceSeries::MAX_SLOTS_PER_DAY + 2)));}
 
 public:
   MQTT();
   virtual ~MQTT() = default;
 
 public:
+  virtual void connected(const std::string& cause) override;
   virtual void connection_lost(const std::string& cause) override;
+  virtual void message_arrived(mqtt::const_message_ptr message) override;
   
 public:
   [[nodiscard]] virtual bool GotPrices(const NorwegianDay& norwegian_day);
   [[nodiscard]] virtual bool PublishCurrentPrices();
+  [[nodiscard]] bool RestorePrices(const NorwegianDay& norwegian_day); //For a day published before a restart. Keeps what GotPrices would have kept, without publishing
+  [[nodiscard]] bool AnswerOptimiserRequest(const std::string& request, std::string& request_id, std::string& response) const; //response is an answer or an error. False if there is no one to answer
+  [[nodiscard]] unsigned int GetCurrentResolutionMinutes() const {return m_current_resolution_minutes;}
+  [[nodiscard]] bool WaitForReconnect(const std::chrono::system_clock::time_point& until); //True if the connection came back (or was first established) before until
+  [[nodiscard]] bool ReplayQueue(); //Sends messages queued while the broker was unreachable. True if nothing is left
+  void ForceFullRepublish() {m_force_full_republish = true;} //Next batch publishes every topic, even if the broker should already have the value
 
 private:
-  [[nodiscard]] bool Publish(const std::string& topic, const double& value, int precision=2);
-  [[nodiscard]] bool Publish(const std::string& topic, const std::string& value);
-  [[nodiscard]] bool GetInfo(const NorwegianDay& norwegian_day, Spotprice::AreaRateType& area_rates, double& exchange_rate) const;
-  void CopyAndSortRates(const Spotprice::DayRateType& eur_rates, std::array<Price,Spotprice::HOURS_PER_DAY>& sorted_prices) const;
+  struct InFlight
+  {
+    mqtt::delivery_token_ptr token;
+    const std::string* topic; //Points into m_topics. nullptr for replayed messages, which are not remembered as acknowledged
+    std::string payload;
+    std::time_t expires_utc;
+    uint16_t announced_alias; //MQTT v5. Alias the message carried together with its full topic, 0 if none
+    unsigned int alias_connection; //Connection the alias belongs to
+  };
+
+  struct AckedPayload
+  {
+    std::string payload;
+    std::time_t expires_utc;
+  };
+
+  struct MessageProperties //Only sent with MQTT v5, but expiry also keeps stale messages out of the outbound queue
+  {
+    std::time_t expires_utc = 0; //0 never expires
+    std::string_view day; //yyyy-mm-dd
+    std::string_view currency;
+  };
+
+  enum DayKind {TODAY, TOMORROW, DAY_KIND_COUNT};
+
+  struct OptimiserDay //Immutable once published in m_optimiser_days
+  {
+    unsigned int resolution_minutes;
+    Currency::ExchangeRates exchange_rates; //Indexed like m_currency_topics
+    std::vector<Optimiser> zones; //Indexed like the zone catalogue
+  };
+
+  //Topics for one zone and day kind. Per-slot lists have MAX_SLOTS_PER_DAY entries
+  struct ZoneTopics
+  {
+    std::vector<std::string> current_currency; //Per currency. Only used for today
+    std::string current_eur;
+    std::string current_order;
+    std::vector<std::vector<std::string>> currency_slots; //[currency][slot]
+    std::vector<std::string> eur_slots;
+    std::vector<std::string> order_slots;
+    std::vector<std::string> sorted_slots;
+    std::string json;
+    std::string cbor;
+  };
+
+  struct DayTopics
+  {
+    std::string resolution;
+    std::string legacy_exchangerate;
+    std::vector<std::string> exchangerate; //Per currency
+    std::string spread_json;
+    std::string spread_cbor;
+    std::vector<ZoneTopics> zones;
+  };
+
+private:
+  void BuildTopics(const ZoneCatalogue& zones, const std::vector<std::string>& currencies); //Once, so publishing never formats a topic
+  [[nodiscard]] bool PublishDayPayloads(const ZoneTopics& zone_topics); //m_day_payload, in each configured format
+  [[nodiscard]] bool PublishSpreadPayloads(const DayTopics& day_topics); //m_spread_payload, in each configured format
+  void UpdateOptimiser(const NorwegianDay& norwegian_day, const Spotprice::AreaRateType& area_rates, const Currency::ExchangeRates& exchange_rates);
+  void SetMessageDay(const NorwegianDay& day, const Timezone& timezone); //Day and expiry for the following messages
+  [[nodiscard]] bool Publish(const std::string& topic, double value, std::string_view currency = {});
+  [[nodiscard]] bool PublishInteger(const std::string& topic, long value, int min_digits=1); //Zero-padded to min_digits
+  [[nodiscard]] bool Publish(const std::string& topic, std::string_view value, std::string_view currency = {}); //Asynchronous. Result is known after CompleteBatch. Skipped if the broker already has value
+  void Send(const std::string* acked_topic, const std::string& topic, std::string_view value, const MessageProperties& properties); //Call from within locked m_connection_mutex
+  [[nodiscard]] mqtt::message_ptr MakeV5Message(const std::string* acked_topic, const std::string& topic, std::string_view value, const MessageProperties& message_properties, uint16_t& announced_alias);
+  [[nodiscard]] uint16_t TopicAlias(const std::string& topic); //0 if out of aliases. Call from within locked m_connection_mutex
+  [[nodiscard]] uint16_t AssignAlias(const std::string& topic);
+  void Enqueue(const std::string& topic, std::string_view value, std::time_t expires_utc); //Call from within locked m_connection_mutex
+  void EnsureConnected(); //Call from within locked m_connection_mutex
+  void UpdateTopicAliasMaximum(const mqtt::token_ptr& connect_token); //From the broker's CONNACK, on every connection
+  void BeginBatch(); //Call from within locked m_connection_mutex
+  void WaitForOldest(); //Call from within locked m_connection_mutex
+  [[nodiscard]] bool CompleteBatch(); //Waits for all in-flight messages. False if any of the messages published since the previous batch failed
+  [[nodiscard]] bool FinishBatch(); //Sends what is queued if connected, completes the batch and saves the queue. Call from within locked m_connection_mutex
+  [[nodiscard]] bool GetInfo(const NorwegianDay& norwegian_day, Spotprice::AreaRateType& area_rates, Currency::ExchangeRates& exchange_rates) const;
+  [[nodiscard]] static std::vector<std::string> CurrencyTopics(const std::vector<std::string>& currencies); //Lowercase
+  void CopyAndSortRates(std::span<const double> eur_rates, std::vector<Price>& sorted_prices) const;
+  void RankRates(std::span<const double> eur_rates, const std::vector<Price>& sorted_prices); //Fills m_order and m_sorted
   
 public:
   [[nodiscard]] static std::string DoubleToString(const double& value, int precision);
+  [[nodiscard]] static std::string_view FormatDouble(double value, int precision, std::span<char> buffer); //Fixed notation, into buffer. No allocation
   
 private:
-  std::unique_ptr<mqtt::client> m_mqtt_client;
+  std::unique_ptr<mqtt::async_client> m_mqtt_client;
   mqtt::connect_options m_connection_options;
 
-  std::mutex m_connection_mutex;
+  std::recursive_mutex m_connection_mutex;
+  const std::size_t m_max_inflight;
+  std::deque<InFlight> m_inflight; //Oldest first
+  bool m_batch_failed;
+  std::unique_ptr<OutboundQueue> m_outbound; //Call from within locked m_connection_mutex
+
+  const bool m_v5;
+  std::atomic<unsigned int> m_connection_count; //Topic aliases are only valid within one connection
+  const uint16_t m_configured_topic_alias_maximum;
+  std::atomic<uint16_t> m_topic_alias_maximum; //Configured maximum, lowered to what the broker of the current connection accepts
+  mqtt::token_ptr m_connect_token; //Completed again by every automatic reconnect. Guarded by m_reconnect_mutex
+  unsigned int m_alias_connection; //Connection m_topic_aliases was built for
+  std::unordered_map<const std::string*, uint16_t> m_topic_aliases; //Keyed by topics in m_topics
+  std::vector<bool> m_alias_announced; //Indexed by alias. True once a message with the topic and the alias was delivered on this connection
+  std::time_t m_message_expires_utc;
+  std::string m_message_day;
+
+  std::atomic<bool> m_session_established;
+  std::mutex m_reconnect_mutex;
+  std::condition_variable m_reconnect_condition;
+  bool m_reconnected;
+
+  std::unordered_map<const std::string*, AckedPayload> m_acked_payloads; //Last payload completed per topic. Keyed by topics in m_topics, which never move
+  const std::time_t m_full_republish_seconds;
+  std::time_t m_next_full_republish;
+  std::atomic<bool> m_force_full_republish;
+  std::size_t m_batch_published;
+  std::size_t m_batch_skipped;
+
+  std::array<DayTopics, DAY_KIND_COUNT> m_topics;
+  std::vector<std::string> m_currency_topics; //Lowercase
+  std::array<char, 64> m_payload_buffer; //Formatted values. Call from within locked m_connection_mutex
+
+  const bool m_legacy_topics;
+  bool m_json_day_payloads;
+  bool m_cbor_day_payloads;
+  std::vector<unsigned int> m_order; //Per slot, for the zone being published
+  std::vector<unsigned int> m_sorted;
+  DayPayload m_day_payload;
+  SpreadPayload m_spread_payload;
+  std::vector<PriceStatistics> m_converted_statistics; //Per currency, for the day being published
+  std::string m_day_payload_buffer;
+
+  std::atomic<unsigned int> m_current_resolution_minutes; //Resolution of the most recently published current prices
+
+  const bool m_optimiser;
+  std::map<unsigned long, std::shared_ptr<const OptimiserDay>> m_optimiser_days; //Days published by GotPrices, or restored by RestorePrices. Guarded by m_optimiser_mutex
+  mutable std::mutex m_optimiser_mutex; //Only held to swap pointers, so requests are answered while a batch is waiting on m_connection_mutex
 };
 
 #endif // _MQTT_H_
@@ -1,31 +1,68 @@
 #include "mqtt_cron.h"
 
+#include <algorithm>
+
+#include <fmt/printf.h>
+
 #include "application.h"
 #include "day.h"
+#include "retry.h"
+
 
+static constexpr std::chrono::minutes MQTT_CRON_INITIAL_RETRY_DELAY = std::chrono::minutes(1);
+static constexpr std::chrono::minutes MQTT_CRON_MAX_RETRY_DELAY = std::chrono::minutes(5);
+
+
+static UTCTime slot_start(const UTCTime& time, unsigned int resolution_minutes)
+{
+  UTCTime slot = time;
+  slot.SetMinute(static_cast<uint8_t>(slot.GetMinute() - slot.GetMinute()%resolution_minutes));
+  slot.SetSecond(0);
+  return slot;
+}
 
 void mqtt_cron(std::stop_token token)
 {
+  RetryScheduler retry_scheduler(MQTT_CRON_INITIAL_RETRY_DELAY, MQTT_CRON_MAX_RETRY_DELAY); //Keyed on the start of the slot that failed
+  bool failed = false;
+  unsigned long failed_slot = 0;
+
   while(!token.stop_requested())
   {
-    //Wait until next whole hour
-    UTCTime this_hour;
-    this_hour.SetMinute(0);
-    this_hour.SetSecond(0);
-    UTCTime next_hour = this_hour.IncrementHoursCopy(1);
-    std::this_thread::sleep_until(std::chrono::system_clock::from_time_t(next_hour.AsUTCTimeT()));
-    
-    //Publish this hour spotprices (and retry after 5 minutes if it fails. (Give up after 50 minutes of retrying..)
-    for (unsigned int retry_count=0; retry_count<10; retry_count++)
+    //Wait until next price slot (whole hour for PT60M, quarter for PT15M)
+    unsigned int resolution_minutes = ::GetApp()->GetMQTT()->GetCurrentResolutionMinutes();
+    UTCTime this_slot = slot_start(UTCTime(), resolution_minutes);
+    UTCTime next_slot = this_slot.IncrementSecondsCopy(static_cast<std::time_t>(resolution_minutes)*60);
+    std::chrono::system_clock::time_point wake_up = std::chrono::system_clock::from_time_t(next_slot.AsUTCTimeT());
+
+    //Prices or exchange rates were not available for this slot. Retry soon, but never past the next slot, which publishes anyway
+    if (failed && failed_slot==static_cast<unsigned long>(this_slot.AsUTCTimeT()))
     {
-      if (::GetApp()->GetMQTT()->PublishCurrentPrices())
+      wake_up = std::min(wake_up, retry_scheduler.RegisterFail(failed_slot));
+      Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("MQTT publish failed. Retrying in %d seconds",
+                                                     std::chrono::duration_cast<std::chrono::seconds>(wake_up - std::chrono::system_clock::now()).count()));
+    }
+
+    //Messages queued while the broker was unreachable are replayed as soon as it is back, not at the next slot
+    while (::GetApp()->GetMQTT()->WaitForReconnect(wake_up))
+    {
+      (void)::GetApp()->GetMQTT()->ReplayQueue();
+    }
+
+    //Publish this slot spotprices. Messages the broker did not get are queued and replayed above. A false return means something was not published (or queued) at all
+    UTCTime publish_slot = slot_start(UTCTime(), resolution_minutes);
+    if (::GetApp()->GetMQTT()->PublishCurrentPrices())
+    {
+      if (failed)
       {
-        break; //Success! Bail out
-      }
-      else {
-        Poco::Logger::get(Logger::DEFAULT).information("MQTT publish failed. Wait 5 minutes, retry");
-        std::this_thread::sleep_for(std::chrono::minutes(5)); //Wait 5 minutes, retry
+        retry_scheduler.RegisterSuccess(failed_slot);
+        failed = false;
       }
     }
+    else
+    {
+      failed = true;
+      failed_slot = static_cast<unsigned long>(publish_slot.AsUTCTimeT());
+    }
   }
 }
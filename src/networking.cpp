@@ -1,11 +1,142 @@
 #include "networking.h"
 
+#include <limits>
+
+#include <Poco/String.h>
+#include <Poco/Net/DNS.h>
 #include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/NetException.h>
+#include <Poco/Net/SSLManager.h>
+
+
+Poco::Net::SocketAddress DNSCache::Resolve(const std::string& host, Poco::UInt16 port)
+{
+  auto now = std::chrono::steady_clock::now();
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_entries_mutex);
+
+    auto existing_entry = m_entries.find(host);
+    if (existing_entry != m_entries.end() && now < existing_entry->second.expires)
+    {
+      return Poco::Net::SocketAddress(existing_entry->second.address, port);
+    }
+  }
+
+  //Resolve without holding the lock
+  const Poco::Net::HostEntry host_entry = Poco::Net::DNS::hostByName(host);
+  const Poco::Net::HostEntry::AddressList& addresses = host_entry.addresses();
+  if (addresses.empty())
+  {
+    throw Poco::Net::HostNotFoundException(host);
+  }
+
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_entries_mutex);
+    m_entries[host] = {addresses.front(), now + CACHE_DURATION};
+  }
+  return Poco::Net::SocketAddress(addresses.front(), port);
+}
+
+void DNSCache::Invalidate(const std::string& host)
+{
+  const std::lock_guard<std::mutex> lock(m_entries_mutex);
+  m_entries.erase(host);
+}
+
+
+PooledHTTPSClientSession::PooledHTTPSClientSession(const std::string& host, Poco::UInt16 port, Poco::Net::Context::Ptr context, Poco::Net::Session::Ptr tls_session, const std::shared_ptr<DNSCache>& dns_cache)
+: Poco::Net::HTTPSClientSession(host, port, context, tls_session),
+  m_dns_cache(dns_cache)
+{
+}
+
+void PooledHTTPSClientSession::reconnect()
+{
+  try
+  {
+    connect(m_dns_cache->Resolve(getHost(), getPort()));
+  }
+  catch (Poco::Net::NetException&)
+  {
+    m_dns_cache->Invalidate(getHost()); //Cached address might be stale
+    throw;
+  }
+}
+
+
+ResponseBody::ResponseBody(std::istream& raw_stream, const Poco::Net::HTTPResponse& response)
+: m_raw_stream(raw_stream)
+{
+  std::string content_encoding = Poco::toLower(response.get("Content-Encoding", ""));
+  if (content_encoding == "gzip" || content_encoding == "x-gzip")
+  {
+    m_inflating_stream = std::make_unique<Poco::InflatingInputStream>(m_raw_stream, Poco::InflatingStreamBuf::STREAM_GZIP);
+  }
+  else if (content_encoding == "deflate")
+  {
+    m_inflating_stream = std::make_unique<Poco::InflatingInputStream>(m_raw_stream, Poco::InflatingStreamBuf::STREAM_ZLIB);
+  }
+}
+
+void ResponseBody::Drain()
+{
+  m_raw_stream.ignore(std::numeric_limits<std::streamsize>::max());
+}
+
 
+Networking::Networking()
+: m_dns_cache(std::make_shared<DNSCache>())
+{
+}
 
 std::shared_ptr<Poco::Net::HTTPSClientSession> Networking::CreateSession(const Poco::URI& uri) const
 {
-  return std::make_shared<Poco::Net::HTTPSClientSession>(uri.getHost(), uri.getPort());
+  Poco::Net::Session::Ptr tls_session;
+  Poco::Net::Context::Ptr context;
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_pools_mutex);
+
+    EvictIdleSessions(std::chrono::steady_clock::now());
+
+    HostPool& pool = m_pools[PoolKey(uri)];
+    if (!pool.idle_sessions.empty())
+    {
+      std::shared_ptr<Poco::Net::HTTPSClientSession> session = pool.idle_sessions.back().session; //Most recently used is most likely to still be alive
+      pool.idle_sessions.pop_back();
+      return session;
+    }
+    tls_session = pool.tls_session;
+
+    if (m_context.isNull())
+    {
+      //Once. SSLManager is only ready after the application has initialized, so not in the constructor
+      m_context = Poco::Net::SSLManager::instance().defaultClientContext();
+      m_context->enableSessionCache(true);
+    }
+    context = m_context;
+  }
+
+  std::shared_ptr<Poco::Net::HTTPSClientSession> session = std::make_shared<PooledHTTPSClientSession>(uri.getHost(), uri.getPort(), context, tls_session, m_dns_cache);
+  session->setKeepAlive(true);
+  session->setKeepAliveTimeout(Poco::Timespan(KEEP_ALIVE_TIMEOUT.count(), 0));
+  return session;
+}
+
+void Networking::ReleaseSession(const Poco::URI& uri, const std::shared_ptr<Poco::Net::HTTPSClientSession>& session) const
+{
+  if (!session.get() || !session->connected())
+  {
+    return;
+  }
+
+  const std::lock_guard<std::mutex> lock(m_pools_mutex);
+
+  HostPool& pool = m_pools[PoolKey(uri)];
+  pool.tls_session = session->sslSession();
+  if (pool.idle_sessions.size() < MAX_IDLE_SESSIONS_PER_HOST)
+  {
+    pool.idle_sessions.push_back({session, std::chrono::steady_clock::now()});
+  }
 }
 
 void Networking::CallGET(const std::shared_ptr<Poco::Net::HTTPSClientSession>& session, const Poco::URI& uri, const std::string& accept) const
@@ -17,7 +148,31 @@ void Networking::CallGET(const std::shared_ptr<Poco::Net::HTTPSClientSession>& s
 
   // send request
   Poco::Net::HTTPRequest req(Poco::Net::HTTPRequest::HTTP_GET, path, Poco::Net::HTTPMessage::HTTP_1_1);
-  session->setKeepAliveTimeout(Poco::Timespan(30, 0));
   req.set("Accept", accept);
+  req.set("Accept-Encoding", ACCEPT_ENCODING);
   session->sendRequest(req);
 }
+
+std::unique_ptr<ResponseBody> Networking::ReceiveResponse(const std::shared_ptr<Poco::Net::HTTPSClientSession>& session, Poco::Net::HTTPResponse& response)
+{
+  std::istream& raw_stream = session->receiveResponse(response);
+  return std::make_unique<ResponseBody>(raw_stream, response);
+}
+
+std::string Networking::PoolKey(const Poco::URI& uri)
+{
+  return uri.getHost() + ":" + std::to_string(uri.getPort());
+}
+
+void Networking::EvictIdleSessions(const std::chrono::steady_clock::time_point& now) const
+{
+  for (auto& pool : m_pools)
+  {
+    //Sessions are released in order, so the oldest idle sessions are at the front
+    std::deque<IdleSession>& idle_sessions = pool.second.idle_sessions;
+    while (!idle_sessions.empty() && idle_sessions.front().idle_since + KEEP_ALIVE_TIMEOUT < now)
+    {
+      idle_sessions.pop_front();
+    }
+  }
+}
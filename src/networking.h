@@ -1,22 +1,113 @@
 #ifndef _NETWORKING_H_
 #define _NETWORKING_H_
 
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 
+#include <Poco/InflatingStream.h>
 #include <Poco/URI.h>
+#include <Poco/Net/Context.h>
 #include <Poco/Net/HTTPResponse.h>
 #include <Poco/Net/HTTPSClientSession.h>
+#include <Poco/Net/IPAddress.h>
+#include <Poco/Net/SocketAddress.h>
+
+
+class DNSCache
+{
+public:
+  static constexpr std::chrono::minutes CACHE_DURATION = std::chrono::minutes(5);
+
+public:
+  [[nodiscard]] Poco::Net::SocketAddress Resolve(const std::string& host, Poco::UInt16 port);
+  void Invalidate(const std::string& host);
+
+private:
+  struct Entry
+  {
+    Poco::Net::IPAddress address;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  std::map<std::string, Entry> m_entries;
+  std::mutex m_entries_mutex;
+};
+
+
+//HTTPS session that resolves its host through the shared DNSCache whenever it (re)connects
+class PooledHTTPSClientSession : public Poco::Net::HTTPSClientSession
+{
+public:
+  PooledHTTPSClientSession(const std::string& host, Poco::UInt16 port, Poco::Net::Context::Ptr context, Poco::Net::Session::Ptr tls_session, const std::shared_ptr<DNSCache>& dns_cache);
+
+protected:
+  void reconnect() override;
+
+private:
+  std::shared_ptr<DNSCache> m_dns_cache;
+};
+
+
+//Response body as a stream. gzip and deflate bodies are inflated while being read, so the parsers never see a compressed
+//or fully buffered body. Must not outlive the session it was received from
+class ResponseBody
+{
+public:
+  ResponseBody(std::istream& raw_stream, const Poco::Net::HTTPResponse& response);
+
+public:
+  [[nodiscard]] std::istream& Stream() {return m_inflating_stream ? *m_inflating_stream : m_raw_stream;}
+  [[nodiscard]] bool IsCompressed() const {return static_cast<bool>(m_inflating_stream);}
+  void Drain(); //Reads any remaining (raw) body, so the session can be reused
+
+private:
+  std::istream& m_raw_stream;
+  std::unique_ptr<Poco::InflatingInputStream> m_inflating_stream;
+};
 
 
 class Networking
 {
 public:
+  static constexpr std::chrono::seconds KEEP_ALIVE_TIMEOUT = std::chrono::seconds(30);
+  static constexpr std::size_t MAX_IDLE_SESSIONS_PER_HOST = 8;
+  static constexpr const char* ACCEPT_ENCODING = "gzip, deflate";
+
+public:
+  Networking();
   virtual ~Networking() = default;
 
 public:
-  [[nodiscard]] virtual std::shared_ptr<Poco::Net::HTTPSClientSession> CreateSession(const Poco::URI& uri) const;
-  virtual void CallGET(const std::shared_ptr<Poco::Net::HTTPSClientSession>& session, const Poco::URI& uri, const std::string& accept) const;
+  [[nodiscard]] virtual std::shared_ptr<Poco::Net::HTTPSClientSession> CreateSession(const Poco::URI& uri) const; //Reuses a warm session from the pool if there is one
+  virtual void ReleaseSession(const Poco::URI& uri, const std::shared_ptr<Poco::Net::HTTPSClientSession>& session) const; //Only release sessions where the response has been read completely
+  virtual void CallGET(const std::shared_ptr<Poco::Net::HTTPSClientSession>& session, const Poco::URI& uri, const std::string& accept) const; //Asks for a compressed response
+  [[nodiscard]] static std::unique_ptr<ResponseBody> ReceiveResponse(const std::shared_ptr<Poco::Net::HTTPSClientSession>& session, Poco::Net::HTTPResponse& response);
+
+private:
+  [[nodiscard]] static std::string PoolKey(const Poco::URI& uri);
+  void EvictIdleSessions(const std::chrono::steady_clock::time_point& now) const; //Not thread-safe funtion. Call from within locked m_pools_mutex
+
+private:
+  struct IdleSession
+  {
+    std::shared_ptr<Poco::Net::HTTPSClientSession> session;
+    std::chrono::steady_clock::time_point idle_since;
+  };
+
+  struct HostPool
+  {
+    std::deque<IdleSession> idle_sessions;
+    Poco::Net::Session::Ptr tls_session; //Most recent TLS session, for resumption when a new connection is needed
+  };
+
+  mutable std::map<std::string, HostPool> m_pools;
+  mutable std::mutex m_pools_mutex;
+  mutable Poco::Net::Context::Ptr m_context; //Shared client context with TLS session caching. Guarded by m_pools_mutex
 
+  std::shared_ptr<DNSCache> m_dns_cache;
 };
 
 #endif // _NETWORKING_H_
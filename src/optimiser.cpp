@@ -0,0 +1,136 @@
+#include "optimiser.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+
+Optimiser::Optimiser(std::span<const double> prices)
+: m_prices(prices.begin(), prices.end()),
+  m_prefix_sums(prices.size()+1, 0.0)
+{
+  std::partial_sum(prices.begin(), prices.end(), m_prefix_sums.begin()+1);
+}
+
+bool Optimiser::CheapestWindow(std::size_t length, std::size_t first_slot, std::size_t end_slot, Plan& plan) const
+{
+  if (0==length || end_slot>m_prices.size() || first_slot>end_slot || length>end_slot-first_slot)
+  {
+    return false;
+  }
+
+  std::size_t best_start = first_slot;
+  double best_cost = m_prefix_sums[first_slot+length] - m_prefix_sums[first_slot];
+  for (std::size_t start=first_slot+1; start+length<=end_slot; start++)
+  {
+    double cost = m_prefix_sums[start+length] - m_prefix_sums[start];
+    if (cost < best_cost)
+    {
+      best_cost = cost;
+      best_start = start;
+    }
+  }
+
+  plan.slots.resize(length);
+  std::iota(plan.slots.begin(), plan.slots.end(), static_cast<unsigned int>(best_start));
+  plan.cost = best_cost;
+  return true;
+}
+
+bool Optimiser::CheapestSlots(std::size_t count, std::size_t first_slot, std::size_t end_slot, Plan& plan) const
+{
+  if (0==count || end_slot>m_prices.size() || first_slot>end_slot || count>end_slot-first_slot)
+  {
+    return false;
+  }
+
+  std::vector<unsigned int> candidates(end_slot-first_slot);
+  std::iota(candidates.begin(), candidates.end(), static_cast<unsigned int>(first_slot));
+  auto cheaper = [this](unsigned int a, unsigned int b) {return m_prices[a]<m_prices[b] || (m_prices[a]==m_prices[b] && a<b);};
+  std::nth_element(candidates.begin(), candidates.begin()+static_cast<std::ptrdiff_t>(count-1), candidates.end(), cheaper);
+
+  plan.slots.assign(candidates.begin(), candidates.begin()+static_cast<std::ptrdiff_t>(count));
+  std::sort(plan.slots.begin(), plan.slots.end());
+  plan.cost = 0.0;
+  for (unsigned int slot : plan.slots)
+  {
+    plan.cost += m_prices[slot];
+  }
+  return true;
+}
+
+bool Optimiser::ScheduleLoad(std::span<const double> profile, bool interruptible, std::size_t first_slot, std::size_t end_slot, Plan& plan) const
+{
+  if (profile.empty() || end_slot>m_prices.size() || first_slot>end_slot || profile.size()>end_slot-first_slot)
+  {
+    return false;
+  }
+  return interruptible ? ScheduleInterruptibleLoad(profile, first_slot, end_slot, plan) : ScheduleContiguousLoad(profile, first_slot, end_slot, plan);
+}
+
+bool Optimiser::ScheduleContiguousLoad(std::span<const double> profile, std::size_t first_slot, std::size_t end_slot, Plan& plan) const
+{
+  //A flat profile is just a cheapest window, scaled
+  if (std::all_of(profile.begin(), profile.end(), [&profile](double energy) {return energy==profile[0];}))
+  {
+    if (!CheapestWindow(profile.size(), first_slot, end_slot, plan))
+    {
+      return false;
+    }
+    plan.cost *= profile[0];
+    return true;
+  }
+
+  std::size_t best_start = first_slot;
+  double best_cost = std::numeric_limits<double>::infinity();
+  for (std::size_t start=first_slot; start+profile.size()<=end_slot; start++)
+  {
+    double cost = std::inner_product(profile.begin(), profile.end(), m_prices.begin()+static_cast<std::ptrdiff_t>(start), 0.0);
+    if (cost < best_cost)
+    {
+      best_cost = cost;
+      best_start = start;
+    }
+  }
+
+  plan.slots.resize(profile.size());
+  std::iota(plan.slots.begin(), plan.slots.end(), static_cast<unsigned int>(best_start));
+  plan.cost = best_cost;
+  return true;
+}
+
+bool Optimiser::ScheduleInterruptibleLoad(std::span<const double> profile, std::size_t first_slot, std::size_t end_slot, Plan& plan) const
+{
+  //best[step] is the lowest cost of running the first step steps within the slots seen so far.
+  //Each slot either runs the next step or is skipped. taken remembers the choice, so the plan can be walked back from the last slot
+  const std::size_t slot_count = end_slot - first_slot;
+  const std::size_t step_count = profile.size();
+  std::vector<double> best(step_count+1, std::numeric_limits<double>::infinity());
+  best[0] = 0.0;
+  std::vector<bool> taken(slot_count*(step_count+1), false);
+  for (std::size_t index=0; index<slot_count; index++)
+  {
+    const double price = m_prices[first_slot+index];
+    for (std::size_t step=std::min(index+1, step_count); step>0; step--) //Descending, so best[step-1] is still from the previous slot
+    {
+      double take_cost = best[step-1] + profile[step-1]*price;
+      if (take_cost < best[step]) //Strict, so ties keep the earlier slot
+      {
+        best[step] = take_cost;
+        taken[index*(step_count+1)+step] = true;
+      }
+    }
+  }
+
+  plan.slots.resize(step_count);
+  std::size_t step = step_count;
+  for (std::size_t index=slot_count; index>0 && step>0; index--)
+  {
+    if (taken[(index-1)*(step_count+1)+step])
+    {
+      plan.slots[--step] = static_cast<unsigned int>(first_slot+index-1);
+    }
+  }
+  plan.cost = best[step_count];
+  return true;
+}
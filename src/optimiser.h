@@ -0,0 +1,43 @@
+#ifndef _OPTIMISER_H_
+#define _OPTIMISER_H_
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+//Answers scheduling questions for one zone and day. Slots are in the resolution of the prices, and a range is [first_slot, end_slot).
+//Built once per published day, so each question only walks the prefix sums or a small table, never the raw prices again
+class Optimiser
+{
+public:
+  struct Plan
+  {
+    std::vector<unsigned int> slots; //Ascending
+    double cost = 0.0; //Sum of price*energy (energy is 1 per slot, unless a load profile says otherwise)
+  };
+
+public:
+  Optimiser() = default;
+  explicit Optimiser(std::span<const double> prices);
+
+public:
+  [[nodiscard]] std::size_t GetSlotCount() const {return m_prices.size();}
+
+  //length contiguous slots with the lowest total price. Earliest start wins ties
+  [[nodiscard]] bool CheapestWindow(std::size_t length, std::size_t first_slot, std::size_t end_slot, Plan& plan) const;
+  //count slots, not necessarily contiguous, with the lowest prices. Earlier slots win ties
+  [[nodiscard]] bool CheapestSlots(std::size_t count, std::size_t first_slot, std::size_t end_slot, Plan& plan) const;
+  //profile[i] is the energy used in the i'th slot the appliance runs. An interruptible load may pause between its steps, but keeps their order
+  [[nodiscard]] bool ScheduleLoad(std::span<const double> profile, bool interruptible, std::size_t first_slot, std::size_t end_slot, Plan& plan) const;
+
+private:
+  [[nodiscard]] bool ScheduleContiguousLoad(std::span<const double> profile, std::size_t first_slot, std::size_t end_slot, Plan& plan) const;
+  [[nodiscard]] bool ScheduleInterruptibleLoad(std::span<const double> profile, std::size_t first_slot, std::size_t end_slot, Plan& plan) const;
+
+private:
+  std::vector<double> m_prices;
+  std::vector<double> m_prefix_sums; //m_prefix_sums[n] is the sum of the first n prices
+};
+
+#endif // _OPTIMISER_H_
@@ -0,0 +1,154 @@
+#include "outboundqueue.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include <fmt/printf.h>
+
+#include <Poco/Logger.h>
+
+#include "logger.h"
+
+
+OutboundQueue::OutboundQueue(const std::string& filename, std::size_t max_messages)
+: m_filename(filename),
+  m_max_messages(std::max<std::size_t>(max_messages, 1)),
+  m_dirty(false)
+{
+}
+
+bool OutboundQueue::Push(const std::string& topic, std::string_view payload, std::time_t expires_utc)
+{
+  m_dirty = true;
+
+  auto queued = m_by_topic.find(topic);
+  if (queued != m_by_topic.end())
+  {
+    //Collapse. Reuse the node, so a stale value costs no allocation
+    m_messages.splice(m_messages.end(), m_messages, queued->second);
+    queued->second->payload.assign(payload);
+    queued->second->expires_utc = expires_utc;
+    return true;
+  }
+
+  bool dropped = false;
+  if (m_messages.size() >= m_max_messages)
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("MQTT outbound queue full. Dropping ")+m_messages.front().topic);
+    m_by_topic.erase(m_messages.front().topic);
+    m_messages.pop_front();
+    dropped = true;
+  }
+  m_messages.push_back({topic, std::string(payload), expires_utc});
+  m_by_topic[topic] = std::prev(m_messages.end());
+  return !dropped;
+}
+
+bool OutboundQueue::PopFront(Message& message)
+{
+  if (m_messages.empty())
+  {
+    return false;
+  }
+  m_by_topic.erase(m_messages.front().topic);
+  message = std::move(m_messages.front());
+  m_messages.pop_front();
+  m_dirty = true;
+  return true;
+}
+
+bool OutboundQueue::Load()
+{
+  if (m_filename.empty())
+  {
+    return true;
+  }
+
+  std::ifstream stream(m_filename, std::ios::binary);
+  if (!stream.is_open())
+  {
+    return true; //Nothing queued
+  }
+
+  uint32_t magic, version, count;
+  if (!Read(stream, magic) || !Read(stream, version) || MAGIC!=magic || VERSION!=version || !Read(stream, count))
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("Ignoring MQTT outbound queue of unknown format or version in ")+m_filename);
+    return false;
+  }
+
+  std::list<Message> messages;
+  for (uint32_t index=0; index<count; index++)
+  {
+    Message message;
+    int64_t expires_utc;
+    if (!ReadString(stream, message.topic, MAX_TOPIC_LENGTH) || !ReadString(stream, message.payload, MAX_PAYLOAD_LENGTH) || !Read(stream, expires_utc))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated MQTT outbound queue in ")+m_filename);
+      return false;
+    }
+    message.expires_utc = static_cast<std::time_t>(expires_utc);
+    messages.push_back(std::move(message));
+  }
+
+  m_messages.clear();
+  m_by_topic.clear();
+  for (Message& message : messages)
+  {
+    (void)Push(message.topic, message.payload, message.expires_utc);
+  }
+  m_dirty = false;
+
+  if (!m_messages.empty())
+  {
+    Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("Loaded %u queued MQTT messages", m_messages.size()));
+  }
+  return true;
+}
+
+bool OutboundQueue::Save()
+{
+  if (m_filename.empty() || !m_dirty)
+  {
+    return true;
+  }
+
+  //Write to a temporary file and rename it, so a crash never leaves a half-written queue
+  std::string tmp_filename = m_filename + ".tmp";
+  {
+    std::ofstream stream(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open())
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Could not write MQTT outbound queue to ")+tmp_filename);
+      return false;
+    }
+
+    Write(stream, MAGIC);
+    Write(stream, VERSION);
+    Write(stream, static_cast<uint32_t>(m_messages.size()));
+    for (const Message& message : m_messages)
+    {
+      WriteString(stream, message.topic);
+      WriteString(stream, message.payload);
+      Write(stream, static_cast<int64_t>(message.expires_utc));
+    }
+
+    if (!stream.flush())
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Could not write MQTT outbound queue to ")+tmp_filename);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tmp_filename, m_filename, error);
+  if (error)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(std::string("Could not rename MQTT outbound queue to ")+m_filename+": "+error.message());
+    return false;
+  }
+  m_dirty = false;
+  return true;
+}
@@ -0,0 +1,54 @@
+#ifndef _OUTBOUNDQUEUE_H_
+#define _OUTBOUNDQUEUE_H_
+
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "binaryio.h"
+
+
+//Retained MQTT messages waiting for the broker, oldest first. Only the newest payload per topic is kept (the broker would only retain that one anyway),
+//and a collapsed topic moves to the back, so replaying the queue gives the same end state as publishing everything in order.
+//Optionally mirrored to a file, so queued messages also survive a restart
+class OutboundQueue : private BinaryIO
+{
+private:
+  static constexpr uint32_t MAGIC = 0x51544d45; //"EMTQ" when stored little-endian
+  static constexpr uint32_t VERSION = 2; //2: Expiry time
+  static constexpr uint32_t MAX_TOPIC_LENGTH = 256;
+  static constexpr uint32_t MAX_PAYLOAD_LENGTH = 64*1024;
+
+public:
+  struct Message
+  {
+    std::string topic;
+    std::string payload;
+    std::time_t expires_utc = 0; //0 never expires
+  };
+
+public:
+  OutboundQueue(const std::string& filename, std::size_t max_messages); //Empty filename keeps the queue in memory only
+
+public:
+  [[nodiscard]] bool Push(const std::string& topic, std::string_view payload, std::time_t expires_utc = 0); //False if the queue is full and the oldest message was dropped
+  [[nodiscard]] bool IsEmpty() const {return m_messages.empty();}
+  [[nodiscard]] std::size_t Size() const {return m_messages.size();}
+  [[nodiscard]] bool PopFront(Message& message); //False if empty
+
+  [[nodiscard]] bool Load(); //Replaces the queue with what is in the file
+  [[nodiscard]] bool Save(); //Only writes if something changed since the last Load/Save
+
+private:
+  const std::string m_filename;
+  const std::size_t m_max_messages;
+
+  std::list<Message> m_messages;
+  std::unordered_map<std::string, std::list<Message>::iterator> m_by_topic;
+  bool m_dirty;
+};
+
+#endif // _OUTBOUNDQUEUE_H_
@@ -0,0 +1,44 @@
+#include "priceseries.h"
+
+#include <algorithm>
+
+
+bool PriceSeries::SetArea(std::size_t area_index, unsigned int resolution_minutes, std::span<const double> prices)
+{
+  if (area_index>=m_area_count || resolution_minutes<m_resolution_minutes || 0!=resolution_minutes%m_resolution_minutes)
+  {
+    return false;
+  }
+
+  std::size_t repeat = resolution_minutes/m_resolution_minutes;
+  if (prices.size()*repeat != m_slot_count)
+  {
+    return false;
+  }
+
+  std::span<double> area_prices = (*this)[area_index];
+  if (1 == repeat)
+  {
+    std::copy(prices.begin(), prices.end(), area_prices.begin());
+  }
+  else
+  {
+    for (std::size_t index=0; index<prices.size(); index++)
+    {
+      std::fill_n(area_prices.begin()+static_cast<std::ptrdiff_t>(index*repeat), repeat, prices[index]);
+    }
+  }
+  return true;
+}
+
+PriceSeries PriceSeries::Converted(double exchange_rate) const
+{
+  PriceSeries converted(m_resolution_minutes, m_slot_count, m_area_count);
+  const double* source = m_prices.data();
+  double* destination = converted.m_prices.data();
+  for (std::size_t index=0; index<m_prices.size(); index++)
+  {
+    destination[index] = source[index] * exchange_rate;
+  }
+  return converted;
+}
@@ -0,0 +1,59 @@
+#ifndef _PRICESERIES_H_
+#define _PRICESERIES_H_
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+
+//Prices for one day for all areas. A day has 23, 24 or 25 hours, so slot_count is not always 24*60/resolution.
+//Slot n of an area covers [local midnight + n*resolution, local midnight + (n+1)*resolution), where local midnight is the start of the day in
+//the area's own timezone (NorwegianDay::StartAsUTCTime(timezone)). Slot n of areas in different timezones is not the same UTC time.
+//Stored as one contiguous block, area by area (all slots for area 0, then all slots for area 1, ...)
+class PriceSeries
+{
+public:
+  static constexpr unsigned int MIN_RESOLUTION_MINUTES = 15;
+  static constexpr std::size_t MAX_SLOTS_PER_DAY = 25*60/MIN_RESOLUTION_MINUTES;
+  [[nodiscard]] static constexpr bool IsDayLayout(unsigned int resolution_minutes, std::size_t slot_count) //A supported resolution, and slots spanning a day of 23, 24 or 25 hours
+    {return MIN_RESOLUTION_MINUTES<=resolution_minutes && resolution_minutes<=60 && 0==60%resolution_minutes &&
+            0==(slot_count*resolution_minutes)%60 && 23*60<=slot_count*resolution_minutes && slot_count*resolution_minutes<=25*60;}
+
+public:
+  PriceSeries() : m_resolution_minutes(60), m_slot_count(0), m_area_count(0) {}
+  PriceSeries(unsigned int resolution_minutes, std::size_t slot_count, std::size_t area_count)
+    : m_resolution_minutes(resolution_minutes), m_slot_count(slot_count), m_area_count(area_count), m_prices(slot_count*area_count, 0.0) {}
+
+public:
+  [[nodiscard]] unsigned int GetResolutionMinutes() const {return m_resolution_minutes;}
+  [[nodiscard]] std::size_t GetSlotCount() const {return m_slot_count;}
+  [[nodiscard]] std::size_t GetAreaCount() const {return m_area_count;}
+  [[nodiscard]] bool IsEmpty() const {return m_prices.empty();}
+
+  [[nodiscard]] std::span<double> operator[](std::size_t area_index) {return std::span<double>(m_prices).subspan(area_index*m_slot_count, m_slot_count);}
+  [[nodiscard]] std::span<const double> operator[](std::size_t area_index) const {return std::span<const double>(m_prices).subspan(area_index*m_slot_count, m_slot_count);}
+  [[nodiscard]] std::span<const double> AllPrices() const {return m_prices;}
+  [[nodiscard]] std::span<double> AllPrices() {return m_prices;}
+
+  //Copy prices for one area into this series. Coarser prices (e.g. PT60M into a PT15M series) are repeated for each slot they cover
+  [[nodiscard]] bool SetArea(std::size_t area_index, unsigned int resolution_minutes, std::span<const double> prices);
+
+  //Same layout, with every price multiplied by exchange_rate. One pass over the contiguous block, so the loop vectorises
+  [[nodiscard]] PriceSeries Converted(double exchange_rate) const;
+
+private:
+  unsigned int m_resolution_minutes;
+  std::size_t m_slot_count;
+  std::size_t m_area_count;
+  std::vector<double> m_prices;
+};
+
+
+//Prices for one day for one area
+struct DayPrices
+{
+  unsigned int resolution_minutes = 60;
+  std::vector<double> prices;
+};
+
+#endif // _PRICESERIES_H_
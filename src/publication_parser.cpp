@@ -0,0 +1,266 @@
+#include "publication_parser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <string_view>
+
+#include <Poco/Exception.h>
+#include <Poco/Logger.h>
+#include <Poco/SAX/InputSource.h>
+#include <Poco/SAX/SAXParser.h>
+
+#include "logger.h"
+
+
+namespace
+{
+  //Whole text, surrounding whitespace allowed. Throws Poco::DataFormatException, so the caller logs the response like for malformed XML
+  template<typename T> T ParseNumber(const std::string& text, const char* name)
+  {
+    static constexpr std::string_view WHITESPACE = " \t\r\n";
+    std::string_view number(text);
+    number.remove_prefix(std::min(number.find_first_not_of(WHITESPACE), number.size()));
+    number.remove_suffix(number.size() - (number.find_last_not_of(WHITESPACE) + 1));
+
+    T value{};
+    std::from_chars_result result = std::from_chars(number.data(), number.data()+number.size(), value);
+    if (std::errc()!=result.ec || result.ptr!=number.data()+number.size())
+    {
+      throw Poco::DataFormatException(std::string("Invalid ")+name, text);
+    }
+    return value;
+  }
+}
+
+
+PublicationParser::PublicationParser(const NorwegianDay& first_day, const NorwegianDay& last_day, const Timezone& timezone)
+: m_first_day(first_day.AsULong()),
+  m_last_day(last_day.AsULong()),
+  m_timezone(timezone),
+  m_in_period(false),
+  m_in_time_interval(false),
+  m_in_point(false),
+  m_got_start(false),
+  m_period_start_utc(0),
+  m_period_end_utc(0),
+  m_resolution_minutes(60),
+  m_position(0)
+{
+}
+
+void PublicationParser::Parse(std::istream& xml_stream)
+{
+  Poco::XML::SAXParser parser;
+  parser.setContentHandler(this);
+  Poco::XML::InputSource xml_src(xml_stream);
+  parser.parse(&xml_src);
+
+  if (!m_got_start)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(std::string("Did not get a start time"));
+  }
+}
+
+bool PublicationParser::GotPrices(const NorwegianDay& norwegian_day, Spotprice::DayRateType& area_prices) const
+{
+  auto parsed_day = m_days.find(norwegian_day.AsULong());
+  if (parsed_day == m_days.end() || parsed_day->second.filled_count < parsed_day->second.filled.size())
+  {
+    return false;
+  }
+
+  area_prices = parsed_day->second.day_prices;
+  return true;
+}
+
+void PublicationParser::startElement(const Poco::XML::XMLString&, const Poco::XML::XMLString& local_name, const Poco::XML::XMLString&, const Poco::XML::Attributes&)
+{
+  m_text.clear();
+
+  if (local_name == "Period")
+  {
+    m_in_period = true;
+    m_resolution_minutes = 60;
+    m_points.clear();
+  }
+  else if (m_in_period && local_name == "timeInterval")
+  {
+    m_in_time_interval = true;
+  }
+  else if (m_in_period && local_name == "Point")
+  {
+    m_in_point = true;
+    m_position = 0;
+    m_price_amount.clear();
+  }
+}
+
+void PublicationParser::endElement(const Poco::XML::XMLString&, const Poco::XML::XMLString& local_name, const Poco::XML::XMLString&)
+{
+  if (local_name == "curveType")
+  {
+    if (m_text!="A01" && m_text!="A03")
+    {
+      Poco::Logger::get(Logger::DEFAULT).information(std::string("Got curveType "+m_text));
+    }
+  }
+  else if (local_name == "resolution")
+  {
+    m_resolution_minutes = ParseResolution(m_text);
+    if (0 == m_resolution_minutes)
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Got unsupported resolution "+m_text));
+    }
+  }
+  else if (m_in_time_interval && local_name == "start")
+  {
+    m_period_start_utc = UTCTime(m_text);
+    m_period_end_utc = m_period_start_utc.IncrementHoursCopy(25); //Until we know better
+    m_got_start = true;
+  }
+  else if (m_in_time_interval && local_name == "end")
+  {
+    m_period_end_utc = UTCTime(m_text);
+  }
+  else if (m_in_point && local_name == "position")
+  {
+    m_position = ParseNumber<int>(m_text, "position");
+  }
+  else if (m_in_point && local_name == "price.amount")
+  {
+    m_price_amount = m_text;
+  }
+  else if (local_name == "timeInterval")
+  {
+    m_in_time_interval = false;
+  }
+  else if (local_name == "Point")
+  {
+    StorePoint();
+    m_in_point = false;
+  }
+  else if (local_name == "Period")
+  {
+    StorePeriod();
+    m_in_period = false;
+  }
+  m_text.clear();
+}
+
+void PublicationParser::characters(const Poco::XML::XMLChar ch[], int start, int length)
+{
+  m_text.append(ch+start, static_cast<std::string::size_type>(length));
+}
+
+void PublicationParser::StorePoint()
+{
+  if (!m_got_start || m_position<1 || m_price_amount.empty() || 0==m_resolution_minutes)
+  {
+    return;
+  }
+
+  m_points.push_back({m_position, ParseNumber<double>(m_price_amount, "price.amount")});
+}
+
+void PublicationParser::StorePeriod()
+{
+  if (m_points.empty() || 0==m_resolution_minutes || !(m_period_start_utc<m_period_end_utc))
+  {
+    return;
+  }
+
+  //Points are normally in order already. Stable, so the last of any duplicate positions wins
+  std::stable_sort(m_points.begin(), m_points.end(), [](const Point& a, const Point& b) {return a.position < b.position;});
+
+  const std::time_t resolution_seconds = static_cast<std::time_t>(m_resolution_minutes)*60;
+  const std::time_t period_start = m_period_start_utc.AsUTCTimeT();
+  const std::time_t period_end = m_period_end_utc.AsUTCTimeT();
+
+  //Local days overlapping the period. A period is normally one day, so this is one or two entries
+  std::vector<DayBoundary> days;
+  for (NorwegianDay local_day=m_period_start_utc.AsLocalDay(m_timezone); days.empty() || days.back().end_utc<period_end; local_day=local_day.IncrementDaysCopy(1))
+  {
+    std::time_t start_utc = local_day.StartAsUTCTime(m_timezone).AsUTCTimeT();
+    std::time_t end_utc = local_day.IncrementDaysCopy(1).StartAsUTCTime(m_timezone).AsUTCTimeT();
+    bool keep = local_day.AsULong()>=m_first_day && local_day.AsULong()<=m_last_day && PrepareDay(local_day.AsULong(), start_utc, end_utc);
+    days.push_back({local_day.AsULong(), start_utc, end_utc, keep});
+  }
+
+  //Both curveType A01 and A03 work if each point fills from its position up to the next point (or the end of the period)
+  std::vector<DayBoundary>::size_type day_index = 0;
+  for (std::vector<Point>::size_type point_index=0; point_index<m_points.size(); point_index++)
+  {
+    std::time_t fill_start = period_start + (m_points[point_index].position-1)*resolution_seconds;
+    std::time_t fill_end = (point_index+1<m_points.size()) ? period_start + (m_points[point_index+1].position-1)*resolution_seconds : period_end;
+    fill_end = std::min(fill_end, period_end);
+
+    for (std::time_t point_time=fill_start; point_time<fill_end; point_time+=resolution_seconds)
+    {
+      while (day_index<days.size() && point_time>=days[day_index].end_utc)
+      {
+        day_index++;
+      }
+      if (day_index>=days.size())
+      {
+        break;
+      }
+      if (!days[day_index].keep)
+      {
+        continue;
+      }
+
+      ParsedDay& day = m_days[days[day_index].day];
+      std::size_t slot = static_cast<std::size_t>((point_time - day.start_utc) / resolution_seconds);
+      if (slot < day.filled.size())
+      {
+        day.day_prices.prices[slot] = m_points[point_index].price;
+        if (!day.filled[slot])
+        {
+          day.filled[slot] = true;
+          day.filled_count++;
+        }
+      }
+    }
+  }
+  m_points.clear();
+}
+
+bool PublicationParser::PrepareDay(unsigned long day, std::time_t start_utc, std::time_t end_utc)
+{
+  auto parsed_day = m_days.find(day);
+  if (parsed_day!=m_days.end() && parsed_day->second.day_prices.resolution_minutes<m_resolution_minutes)
+  {
+    return false; //Already got this day at a finer resolution
+  }
+  if (parsed_day==m_days.end() || parsed_day->second.day_prices.resolution_minutes>m_resolution_minutes)
+  {
+    //First price for this day, or a finer resolution than before. Start over with slots for the whole day (23, 24 or 25 hours)
+    std::size_t slot_count = static_cast<std::size_t>((end_utc - start_utc) / (static_cast<std::time_t>(m_resolution_minutes)*60));
+    ParsedDay& new_day = m_days[day];
+    new_day.start_utc = start_utc;
+    new_day.day_prices.resolution_minutes = m_resolution_minutes;
+    new_day.day_prices.prices.assign(slot_count, 0.0);
+    new_day.filled.assign(slot_count, false);
+    new_day.filled_count = 0;
+  }
+  return true;
+}
+
+unsigned int PublicationParser::ParseResolution(const std::string& resolution)
+{
+  //ISO 8601 duration, like PT15M, PT60M or PT1H
+  unsigned int value = 0;
+  char unit = '\0';
+  if (2 != std::sscanf(resolution.c_str(), "PT%u%c", &value, &unit))
+  {
+    return 0;
+  }
+
+  unsigned int minutes = ('H'==unit) ? value*60 : (('M'==unit) ? value : 0);
+  if (minutes<PriceSeries::MIN_RESOLUTION_MINUTES || minutes>60 || 0!=60%minutes)
+  {
+    return 0;
+  }
+  return minutes;
+}
@@ -0,0 +1,83 @@
+#ifndef _PUBLICATION_PARSER_H_
+#define _PUBLICATION_PARSER_H_
+
+#include <istream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Poco/SAX/Attributes.h>
+#include <Poco/SAX/DefaultHandler.h>
+
+#include "day.h"
+#include "spotprice.h"
+#include "timezone.h"
+
+
+//Single-pass SAX parser for ENTSO-E A44 Publication_MarketDocument. Points are collected per Period and written into
+//per-day rates when the Period ends, so neither the document tree nor the response body is kept in memory.
+//A document may hold several Periods (one per market day). Only days from first_day to last_day are kept.
+//Days are local days in the timezone of the bidding zone
+class PublicationParser : public Poco::XML::DefaultHandler
+{
+public:
+  PublicationParser(const NorwegianDay& first_day, const NorwegianDay& last_day, const Timezone& timezone = Timezone::Norway());
+
+public:
+  void Parse(std::istream& xml_stream); //Throws Poco::Exception on malformed XML, or a position or price that is not a number
+  [[nodiscard]] bool GotPrices(const NorwegianDay& norwegian_day, Spotprice::DayRateType& area_prices) const; //False unless every slot of the day got a price
+
+public:
+  void startElement(const Poco::XML::XMLString& uri, const Poco::XML::XMLString& local_name, const Poco::XML::XMLString& qname, const Poco::XML::Attributes& attributes) override;
+  void endElement(const Poco::XML::XMLString& uri, const Poco::XML::XMLString& local_name, const Poco::XML::XMLString& qname) override;
+  void characters(const Poco::XML::XMLChar ch[], int start, int length) override;
+
+private:
+  void StorePoint();
+  void StorePeriod(); //Maps all points of the period to local days and slots in one linear pass
+  [[nodiscard]] bool PrepareDay(unsigned long day, std::time_t start_utc, std::time_t end_utc); //False if day already has a finer resolution
+  [[nodiscard]] static unsigned int ParseResolution(const std::string& resolution); //Minutes, or 0 if not supported
+
+private:
+  struct Point
+  {
+    int position;
+    double price;
+  };
+
+  struct DayBoundary //One local day overlapping the period, in UTC. Computed once per day, not per point
+  {
+    unsigned long day;
+    std::time_t start_utc;
+    std::time_t end_utc;
+    bool keep;
+  };
+
+  struct ParsedDay
+  {
+    std::time_t start_utc;
+    Spotprice::DayRateType day_prices;
+    std::vector<bool> filled;
+    std::size_t filled_count;
+  };
+
+  const unsigned long m_first_day;
+  const unsigned long m_last_day;
+  const Timezone& m_timezone;
+  std::map<unsigned long, ParsedDay> m_days;
+
+  std::string m_text;
+  bool m_in_period;
+  bool m_in_time_interval;
+  bool m_in_point;
+
+  bool m_got_start;
+  UTCTime m_period_start_utc;
+  UTCTime m_period_end_utc;
+  unsigned int m_resolution_minutes;
+  int m_position;
+  std::string m_price_amount;
+  std::vector<Point> m_points; //Points in current period
+};
+
+#endif // _PUBLICATION_PARSER_H_
@@ -0,0 +1,59 @@
+#include "quota.h"
+
+#include <algorithm>
+
+#include "day.h"
+
+
+MonthlyQuota::MonthlyQuota(unsigned int limit, unsigned int reserve)
+: m_limit(limit),
+  m_reserve(std::min(reserve, limit)),
+  m_month(0),
+  m_used(0)
+{
+}
+
+bool MonthlyQuota::TryConsume(Priority priority, uint32_t month)
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  unsigned int available = (Priority::ESSENTIAL == priority) ? m_limit : m_limit-m_reserve;
+  unsigned int used = UsedIn(month);
+  if (used >= available)
+  {
+    return false;
+  }
+
+  m_month = month;
+  m_used = used+1;
+  return true;
+}
+
+unsigned int MonthlyQuota::GetRemaining(Priority priority, uint32_t month) const
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  unsigned int available = (Priority::ESSENTIAL == priority) ? m_limit : m_limit-m_reserve;
+  return available - std::min(UsedIn(month), available);
+}
+
+void MonthlyQuota::GetUsage(uint32_t& month, uint32_t& used) const
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  month = m_month;
+  used = m_used;
+}
+
+void MonthlyQuota::SetUsage(uint32_t month, uint32_t used)
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  if (month >= m_month) //Never go back to an older month
+  {
+    m_month = month;
+    m_used = used;
+  }
+}
+
+uint32_t MonthlyQuota::CurrentMonth()
+{
+  UTCTime now;
+  return static_cast<uint32_t>(now.GetYear())*100 + now.GetMonth();
+}
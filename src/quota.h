@@ -0,0 +1,44 @@
+#ifndef _QUOTA_H_
+#define _QUOTA_H_
+
+#include <cstdint>
+#include <mutex>
+
+
+//Requests used of a monthly request limit. The last reserve requests of a month are kept for essential requests only,
+//so backfill and other optional fetches can never use up what is needed to publish today's and tomorrow's prices.
+//Months are UTC calendar months, as yyyymm
+class MonthlyQuota
+{
+public:
+  enum class Priority
+  {
+    ESSENTIAL,
+    OPTIONAL
+  };
+
+public:
+  MonthlyQuota(unsigned int limit, unsigned int reserve);
+
+public:
+  [[nodiscard]] bool TryConsume(Priority priority, uint32_t month = CurrentMonth()); //False if the request would exceed the quota
+  [[nodiscard]] unsigned int GetRemaining(Priority priority, uint32_t month = CurrentMonth()) const;
+
+  void GetUsage(uint32_t& month, uint32_t& used) const;
+  void SetUsage(uint32_t month, uint32_t used);
+
+  [[nodiscard]] static uint32_t CurrentMonth();
+
+private:
+  [[nodiscard]] unsigned int UsedIn(uint32_t month) const {return (month == m_month) ? m_used : 0;} //Call from within locked m_mutex
+
+private:
+  const unsigned int m_limit;
+  const unsigned int m_reserve;
+
+  uint32_t m_month;
+  uint32_t m_used;
+  mutable std::mutex m_mutex;
+};
+
+#endif // _QUOTA_H_
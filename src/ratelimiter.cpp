@@ -0,0 +1,59 @@
+#include "ratelimiter.h"
+
+#include <algorithm>
+
+
+RateLimiter::RateLimiter(unsigned int requests_per_minute, unsigned int burst)
+: m_token_interval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::minutes(1)) / std::max(requests_per_minute, 1u)),
+  m_burst(static_cast<double>(std::max(burst, 1u))),
+  m_tokens(m_burst),
+  m_last_refill(std::chrono::steady_clock::now()),
+  m_next_ticket(0)
+{
+}
+
+void RateLimiter::Acquire(Priority priority)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  const std::pair<Priority, uint64_t> ticket{priority, m_next_ticket++};
+  m_waiters.insert(ticket);
+
+  while (true)
+  {
+    auto now = std::chrono::steady_clock::now();
+    Refill(now);
+    if (*m_waiters.begin() == ticket)
+    {
+      if (m_tokens >= 1.0)
+      {
+        m_tokens -= 1.0;
+        m_waiters.erase(m_waiters.begin());
+        m_cv.notify_all(); //Next in line may have a token as well
+        return;
+      }
+      m_cv.wait_until(lock, now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_token_interval * (1.0 - m_tokens)));
+    }
+    else
+    {
+      m_cv.wait(lock);
+    }
+  }
+}
+
+bool RateLimiter::TryAcquire()
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  Refill(std::chrono::steady_clock::now());
+  if (!m_waiters.empty() || m_tokens < 1.0)
+  {
+    return false;
+  }
+  m_tokens -= 1.0;
+  return true;
+}
+
+void RateLimiter::Refill(const std::chrono::steady_clock::time_point& now)
+{
+  m_tokens = std::min(m_burst, m_tokens + std::chrono::duration<double>(now - m_last_refill) / std::chrono::duration<double>(m_token_interval));
+  m_last_refill = now;
+}
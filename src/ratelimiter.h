@@ -0,0 +1,46 @@
+#ifndef _RATELIMITER_H_
+#define _RATELIMITER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <utility>
+
+
+//Token bucket shared by all requests to one upstream API. Waiting callers are served by priority, then in arrival order,
+//so requests for today are not queued behind a long backfill
+class RateLimiter
+{
+public:
+  enum class Priority
+  {
+    TODAY = 0,
+    TOMORROW = 1,
+    BACKFILL = 2
+  };
+
+public:
+  RateLimiter(unsigned int requests_per_minute, unsigned int burst);
+
+public:
+  void Acquire(Priority priority); //Blocks until a request may be sent
+  [[nodiscard]] bool TryAcquire();
+
+private:
+  void Refill(const std::chrono::steady_clock::time_point& now); //Call from within locked m_mutex
+
+private:
+  const std::chrono::steady_clock::duration m_token_interval;
+  const double m_burst;
+
+  double m_tokens;
+  std::chrono::steady_clock::time_point m_last_refill;
+  std::set<std::pair<Priority, uint64_t>> m_waiters; //First is next to be served
+  uint64_t m_next_ticket;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+};
+
+#endif // _RATELIMITER_H_
@@ -0,0 +1,98 @@
+#include "retry.h"
+
+#include <algorithm>
+
+
+RetryScheduler::RetryScheduler(std::chrono::seconds initial_delay, std::chrono::seconds max_delay, double jitter)
+: m_initial_delay(initial_delay),
+  m_max_delay(std::max(initial_delay, max_delay)),
+  m_jitter(std::clamp(jitter, 0.0, 1.0)),
+  m_random(std::random_device()())
+{
+}
+
+bool RetryScheduler::MayAttempt(unsigned long key, const TimePoint& now)
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  Expire(now);
+
+  auto entry = m_entries.find(key);
+  return entry==m_entries.end() || entry->second.next_attempt<=now;
+}
+
+RetryScheduler::TimePoint RetryScheduler::RegisterFail(unsigned long key, const TimePoint& now)
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  Expire(now);
+
+  unsigned int fail_count = 1;
+  auto entry = m_entries.find(key);
+  if (entry != m_entries.end())
+  {
+    fail_count = entry->second.fail_count + 1;
+    Erase(entry);
+  }
+
+  //initial_delay * 2^(fail_count-1), capped at max_delay. Shift is capped so it can not overflow
+  std::chrono::seconds delay = std::min(m_initial_delay * (std::chrono::seconds::rep{1} << std::min(fail_count-1, 20u)), m_max_delay);
+  if (m_jitter > 0.0)
+  {
+    std::uniform_real_distribution<double> distribution(1.0-m_jitter, 1.0+m_jitter);
+    delay = std::chrono::seconds(static_cast<std::chrono::seconds::rep>(static_cast<double>(delay.count()) * distribution(m_random)));
+  }
+
+  TimePoint next_attempt = now + delay;
+  m_entries[key] = Entry{fail_count, next_attempt};
+  m_expiry.insert({next_attempt + m_max_delay, key});
+  return next_attempt;
+}
+
+void RetryScheduler::RegisterSuccess(unsigned long key)
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = m_entries.find(key);
+  if (entry != m_entries.end())
+  {
+    Erase(entry);
+  }
+}
+
+bool RetryScheduler::GetNextAttempt(unsigned long key, TimePoint& next_attempt) const
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = m_entries.find(key);
+  if (entry==m_entries.end() || entry->second.next_attempt<=std::chrono::system_clock::now())
+  {
+    return false;
+  }
+  next_attempt = entry->second.next_attempt;
+  return true;
+}
+
+unsigned int RetryScheduler::GetFailCount(unsigned long key) const
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  auto entry = m_entries.find(key);
+  return (entry==m_entries.end()) ? 0 : entry->second.fail_count;
+}
+
+std::size_t RetryScheduler::Size() const
+{
+  const std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+void RetryScheduler::Expire(const TimePoint& now)
+{
+  while (!m_expiry.empty() && m_expiry.begin()->first<now)
+  {
+    m_entries.erase(m_expiry.begin()->second);
+    m_expiry.erase(m_expiry.begin());
+  }
+}
+
+void RetryScheduler::Erase(std::map<unsigned long, Entry>::iterator entry)
+{
+  m_expiry.erase({entry->second.next_attempt + m_max_delay, entry->first});
+  m_entries.erase(entry);
+}
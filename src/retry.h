@@ -0,0 +1,53 @@
+#ifndef _RETRY_H_
+#define _RETRY_H_
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <utility>
+
+
+//Per-key exponential backoff with jitter. Keys are typically NorwegianDay::AsULong().
+//A key is forgotten (and starts over at the initial delay) when it has not failed for max_delay after its last retry time
+class RetryScheduler
+{
+public:
+  typedef std::chrono::system_clock::time_point TimePoint;
+
+public:
+  RetryScheduler(std::chrono::seconds initial_delay, std::chrono::seconds max_delay, double jitter = 0.2);
+
+public:
+  [[nodiscard]] bool MayAttempt(unsigned long key, const TimePoint& now = std::chrono::system_clock::now()); //False while key is backing off
+  TimePoint RegisterFail(unsigned long key, const TimePoint& now = std::chrono::system_clock::now()); //Returns when the next attempt may be done
+  void RegisterSuccess(unsigned long key);
+
+  [[nodiscard]] bool GetNextAttempt(unsigned long key, TimePoint& next_attempt) const; //False if key is not backing off
+  [[nodiscard]] unsigned int GetFailCount(unsigned long key) const;
+  [[nodiscard]] std::size_t Size() const;
+
+private:
+  struct Entry
+  {
+    unsigned int fail_count;
+    TimePoint next_attempt;
+  };
+
+private:
+  void Expire(const TimePoint& now); //Call from within locked m_mutex
+  void Erase(std::map<unsigned long, Entry>::iterator entry); //Call from within locked m_mutex
+
+private:
+  const std::chrono::seconds m_initial_delay;
+  const std::chrono::seconds m_max_delay;
+  const double m_jitter;
+
+  std::map<unsigned long, Entry> m_entries;
+  std::set<std::pair<TimePoint, unsigned long>> m_expiry; //Ordered by when each entry is forgotten, so expiry never scans
+  std::minstd_rand m_random;
+  mutable std::mutex m_mutex;
+};
+
+#endif // _RETRY_H_
@@ -0,0 +1,65 @@
+#ifndef _SINGLEFLIGHT_H_
+#define _SINGLEFLIGHT_H_
+
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+
+
+//Coalesces concurrent calls for the same key. The first caller runs the function, callers arriving while it runs
+//wait for and get the same result (or the same exception). Nothing is cached once the call has completed
+template<typename Key, typename Result>
+class SingleFlight
+{
+public:
+  Result Do(const Key& key, const std::function<Result()>& function)
+  {
+    std::promise<Result> promise;
+    std::shared_future<Result> future;
+    bool leader = false;
+    { //Lock scope
+      const std::lock_guard<std::mutex> lock(m_mutex);
+      auto in_flight = m_in_flight.find(key);
+      if (in_flight != m_in_flight.end())
+      {
+        future = in_flight->second;
+      }
+      else
+      {
+        future = promise.get_future().share();
+        m_in_flight.emplace(key, future);
+        leader = true;
+      }
+    }
+
+    if (leader)
+    {
+      try
+      {
+        promise.set_value(function());
+      }
+      catch (...)
+      {
+        promise.set_exception(std::current_exception());
+      }
+
+      const std::lock_guard<std::mutex> lock(m_mutex);
+      m_in_flight.erase(key);
+    }
+    return future.get();
+  }
+
+  [[nodiscard]] std::size_t InFlight() const
+  {
+    const std::lock_guard<std::mutex> lock(m_mutex);
+    return m_in_flight.size();
+  }
+
+private:
+  std::map<Key, std::shared_future<Result>> m_in_flight;
+  mutable std::mutex m_mutex;
+};
+
+#endif // _SINGLEFLIGHT_H_
@@ -0,0 +1,262 @@
+#include "snapshot.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <span>
+
+#include <fmt/printf.h>
+
+#include <Poco/Logger.h>
+
+#include "application.h"
+
+
+Snapshot::Snapshot(const std::string& filename)
+: m_filename(filename),
+  m_published_today(0),
+  m_published_tomorrow(0)
+{
+}
+
+bool Snapshot::Load()
+{
+  const std::lock_guard<std::mutex> file_lock(m_file_mutex);
+
+  std::ifstream stream(m_filename, std::ios::binary);
+  if (!stream.is_open())
+  {
+    Poco::Logger::get(Logger::DEFAULT).information(std::string("No snapshot in ")+m_filename);
+    return false;
+  }
+
+  uint32_t magic, version;
+  if (!Read(stream, magic) || !Read(stream, version) || MAGIC!=magic || VERSION!=version)
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("Ignoring snapshot of unknown format or version in ")+m_filename);
+    return false;
+  }
+
+  uint32_t published_today, published_tomorrow;
+  if (!Read(stream, published_today) || !Read(stream, published_tomorrow))
+  {
+    return false;
+  }
+
+  //Zones. Area indexes in the spotprices below are only valid for the same zones in the same order
+  const ZoneCatalogue& zones = ::GetApp()->GetSpotprice()->GetZones();
+  uint32_t zone_count;
+  if (!Read(stream, zone_count) || zones.size()!=zone_count)
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("Ignoring snapshot for other zones in ")+m_filename);
+    return false;
+  }
+  for (uint32_t zone_index=0; zone_index<zone_count; zone_index++)
+  {
+    std::string zone_id;
+    if (!ReadString(stream, zone_id, MAX_STRING_LENGTH) || zones[zone_index].id!=zone_id)
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Ignoring snapshot for other zones in ")+m_filename);
+      return false;
+    }
+  }
+
+  //Spotprices
+  std::map<unsigned long, Spotprice::AreaRateType> eur_rates;
+  uint32_t day_count;
+  if (!Read(stream, day_count))
+  {
+    return false;
+  }
+  for (uint32_t day_index=0; day_index<day_count; day_index++)
+  {
+    uint32_t day, resolution_minutes, slot_count, area_count;
+    if (!Read(stream, day) || !Read(stream, resolution_minutes) || !Read(stream, slot_count) || !Read(stream, area_count))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated snapshot in ")+m_filename);
+      return false;
+    }
+    if (zones.size()!=area_count || !PriceSeries::IsDayLayout(resolution_minutes, slot_count))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Ignoring snapshot with unexpected spotprice layout in ")+m_filename);
+      return false;
+    }
+
+    Spotprice::AreaRateType area_rates(resolution_minutes, slot_count, area_count);
+    std::span<double> prices = area_rates.AllPrices();
+    if (!stream.read(reinterpret_cast<char*>(prices.data()), static_cast<std::streamsize>(prices.size_bytes())))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated snapshot in ")+m_filename);
+      return false;
+    }
+    eur_rates[day] = std::move(area_rates);
+  }
+
+  //Exchange rates. Only used if the currencies are the same, but spotprices are still valid if they are not
+  const std::vector<std::string>& currencies = ::GetApp()->GetCurrency()->GetCurrencies();
+  uint32_t currency_count;
+  if (!Read(stream, currency_count) || MAX_CURRENCIES<currency_count)
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated snapshot in ")+m_filename);
+    return false;
+  }
+  bool same_currencies = (currencies.size()==currency_count);
+  for (uint32_t currency_index=0; currency_index<currency_count; currency_index++)
+  {
+    std::string currency;
+    if (!ReadString(stream, currency, MAX_STRING_LENGTH))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated snapshot in ")+m_filename);
+      return false;
+    }
+    same_currencies &= (currency_index<currencies.size() && currencies[currency_index]==currency);
+  }
+
+  std::map<unsigned long, Currency::ExchangeRates> exchange_rates;
+  if (!Read(stream, day_count))
+  {
+    return false;
+  }
+  for (uint32_t day_index=0; day_index<day_count; day_index++)
+  {
+    uint32_t day;
+    Currency::ExchangeRates rates(currency_count);
+    if (!Read(stream, day) || !stream.read(reinterpret_cast<char*>(rates.data()), static_cast<std::streamsize>(rates.size()*sizeof(double))))
+    {
+      Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated snapshot in ")+m_filename);
+      return false;
+    }
+    if (same_currencies)
+    {
+      exchange_rates[day] = std::move(rates);
+    }
+  }
+  if (!same_currencies)
+  {
+    Poco::Logger::get(Logger::DEFAULT).information(std::string("Ignoring exchange rates for other currencies in ")+m_filename);
+  }
+
+  uint32_t quota_month, quota_used;
+  if (!Read(stream, quota_month) || !Read(stream, quota_used))
+  {
+    Poco::Logger::get(Logger::DEFAULT).warning(std::string("Truncated snapshot in ")+m_filename);
+    return false;
+  }
+
+  //Everything is read. Apply it
+  ::GetApp()->GetSpotprice()->SetCachedEurRates(eur_rates);
+  ::GetApp()->GetCurrency()->SetCachedRates(exchange_rates);
+  ::GetApp()->GetCurrency()->GetQuota().SetUsage(quota_month, quota_used);
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_published_mutex);
+    m_published_today = published_today;
+    m_published_tomorrow = published_tomorrow;
+  }
+
+  Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("Loaded snapshot with %u days of spotprices and %u exchange rates", eur_rates.size(), exchange_rates.size()));
+  return true;
+}
+
+bool Snapshot::Save()
+{
+  //Saved after fetches in several threads. Read what to save under the file lock too, so an older state never replaces a newer one
+  const std::lock_guard<std::mutex> file_lock(m_file_mutex);
+
+  std::map<unsigned long, Spotprice::AreaRateType> eur_rates;
+  ::GetApp()->GetSpotprice()->GetCachedEurRates(eur_rates);
+
+  const std::vector<std::string>& currencies = ::GetApp()->GetCurrency()->GetCurrencies();
+  std::map<unsigned long, Currency::ExchangeRates> exchange_rates;
+  ::GetApp()->GetCurrency()->GetCachedRates(exchange_rates);
+  uint32_t quota_month, quota_used;
+  ::GetApp()->GetCurrency()->GetQuota().GetUsage(quota_month, quota_used);
+
+  uint32_t published_today, published_tomorrow;
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_published_mutex);
+    published_today = static_cast<uint32_t>(m_published_today);
+    published_tomorrow = static_cast<uint32_t>(m_published_tomorrow);
+  }
+
+  //Write to a temporary file and rename it, so a crash never leaves a half-written snapshot
+  std::string tmp_filename = m_filename + ".tmp";
+  {
+    std::ofstream stream(tmp_filename, std::ios::binary | std::ios::trunc);
+    if (!stream.is_open())
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Could not write snapshot to ")+tmp_filename);
+      return false;
+    }
+
+    Write(stream, MAGIC);
+    Write(stream, VERSION);
+    Write(stream, published_today);
+    Write(stream, published_tomorrow);
+
+    const ZoneCatalogue& zones = ::GetApp()->GetSpotprice()->GetZones();
+    Write(stream, static_cast<uint32_t>(zones.size()));
+    for (const Area& area : zones)
+    {
+      WriteString(stream, area.id);
+    }
+
+    Write(stream, static_cast<uint32_t>(eur_rates.size()));
+    for (const auto& eur_rate : eur_rates)
+    {
+      Write(stream, static_cast<uint32_t>(eur_rate.first));
+      Write(stream, static_cast<uint32_t>(eur_rate.second.GetResolutionMinutes()));
+      Write(stream, static_cast<uint32_t>(eur_rate.second.GetSlotCount()));
+      Write(stream, static_cast<uint32_t>(eur_rate.second.GetAreaCount()));
+      std::span<const double> prices = eur_rate.second.AllPrices();
+      stream.write(reinterpret_cast<const char*>(prices.data()), static_cast<std::streamsize>(prices.size_bytes()));
+    }
+
+    Write(stream, static_cast<uint32_t>(currencies.size()));
+    for (const std::string& currency : currencies)
+    {
+      WriteString(stream, currency);
+    }
+    Write(stream, static_cast<uint32_t>(exchange_rates.size()));
+    for (const auto& exchange_rate : exchange_rates)
+    {
+      Write(stream, static_cast<uint32_t>(exchange_rate.first));
+      stream.write(reinterpret_cast<const char*>(exchange_rate.second.data()), static_cast<std::streamsize>(exchange_rate.second.size()*sizeof(double)));
+    }
+    Write(stream, quota_month);
+    Write(stream, quota_used);
+
+    if (!stream.flush())
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Could not write snapshot to ")+tmp_filename);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tmp_filename, m_filename, error);
+  if (error)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(std::string("Could not rename snapshot to ")+m_filename+": "+error.message());
+    return false;
+  }
+  return true;
+}
+
+void Snapshot::SetPublishedDays(const NorwegianDay& today, const NorwegianDay& tomorrow)
+{
+  const std::lock_guard<std::mutex> lock(m_published_mutex);
+  m_published_today = today.AsULong();
+  m_published_tomorrow = tomorrow.AsULong();
+}
+
+bool Snapshot::GetPublishedDays(NorwegianDay& today, NorwegianDay& tomorrow) const
+{
+  const std::lock_guard<std::mutex> lock(m_published_mutex);
+  if (0 == m_published_today)
+  {
+    return false;
+  }
+  today = NorwegianDay(m_published_today);
+  tomorrow = NorwegianDay(m_published_tomorrow);
+  return true;
+}
@@ -0,0 +1,42 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "binaryio.h"
+#include "day.h"
+
+
+//Binary, versioned snapshot of cached spotprices, exchange rates, exchange rate requests used this month and what spotprice_cron has already published.
+//Written after each successful fetch or publish, and loaded at startup, so a restart does not need any network calls
+class Snapshot : private BinaryIO
+{
+private:
+  static constexpr uint32_t MAGIC = 0x50534c45; //"ELSP" when stored little-endian
+  static constexpr uint32_t VERSION = 5; //2: Spotprice days carry their own resolution and slot count. 3: Zone ids. 4: Exchange rate quota usage. 5: Currencies
+  static constexpr uint32_t MAX_CURRENCIES = 64;
+  static constexpr uint32_t MAX_STRING_LENGTH = 256; //Zone ids and currencies
+
+public:
+  Snapshot(const std::string& filename);
+
+public:
+  [[nodiscard]] bool Load();
+  [[nodiscard]] bool Save();
+
+  void SetPublishedDays(const NorwegianDay& today, const NorwegianDay& tomorrow);
+  [[nodiscard]] bool GetPublishedDays(NorwegianDay& today, NorwegianDay& tomorrow) const; //False if nothing has been published
+
+private:
+  const std::string m_filename;
+
+  unsigned long m_published_today;
+  unsigned long m_published_tomorrow;
+  mutable std::mutex m_published_mutex;
+
+  std::mutex m_file_mutex; //Held while Save reads the caches and writes the file
+};
+
+#endif // _SNAPSHOT_H_
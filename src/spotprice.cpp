@@ -1,29 +1,73 @@
 #include "spotprice.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <fstream>
-#include <sstream>
+#include <streambuf>
 #include <thread>
+#include <vector>
 
 #include <fmt/printf.h>
 
 #include <Poco/Logger.h>
-#include <Poco/DOM/AutoPtr.h>
-#include <Poco/DOM/Document.h>
-#include <Poco/DOM/DOMParser.h>
-#include <Poco/DOM/NodeList.h>
-#include <Poco/SAX/InputSource.h>
+#include <Poco/TeeStream.h>
 
 #include "application.h"
+#include "publication_parser.h"
 
 
-bool Spotprice::HasEurRate(const NorwegianDay& norwegian_day) const
+namespace
 {
-  { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_eur_rates_mutex);
+  //Keeps the first max_size bytes written to it and discards the rest, so a response body can be logged without keeping all of it
+  class PrefixBuffer : public std::streambuf
+  {
+  public:
+    explicit PrefixBuffer(std::size_t max_size) : m_max_size(max_size) {}
 
-    return m_eur_rates.find(norwegian_day.AsULong()) != m_eur_rates.end();
-  }
+  public:
+    [[nodiscard]] const std::string& Prefix() const {return m_prefix;}
+
+  protected:
+    int_type overflow(int_type c) override
+    {
+      if (!traits_type::eq_int_type(c, traits_type::eof()) && m_prefix.size()<m_max_size)
+      {
+        m_prefix.push_back(traits_type::to_char_type(c));
+      }
+      return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize count) override
+    {
+      m_prefix.append(s, std::min(static_cast<std::size_t>(count), m_max_size-m_prefix.size()));
+      return count;
+    }
+
+  private:
+    const std::size_t m_max_size;
+    std::string m_prefix;
+  };
+}
+
+
+Spotprice::Spotprice()
+: Spotprice(ZoneCatalogue(), DEFAULT_REQUESTS_PER_MINUTE)
+{
+}
+
+Spotprice::Spotprice(const ZoneCatalogue& zones, unsigned int requests_per_minute)
+: m_zones(zones),
+  m_rate_limiter(requests_per_minute, RATE_LIMIT_BURST),
+  m_eur_rates(std::make_shared<const RateMapType>()),
+  m_retry_scheduler(INITIAL_RETRY_DELAY, MAX_RETRY_DELAY)
+{
+}
+
+bool Spotprice::HasEurRate(const NorwegianDay& norwegian_day) const
+{
+  std::shared_ptr<const RateMapType> eur_rates = m_eur_rates.load();
+  return eur_rates->find(norwegian_day.AsULong()) != eur_rates->end();
 }
 
 bool Spotprice::CacheEurRates(const NorwegianDay& norwegian_day)
@@ -34,218 +78,402 @@ bool Spotprice::CacheEurRates(const NorwegianDay& norwegian_day)
 
 bool Spotprice::GetEurRates(const NorwegianDay& norwegian_day, AreaRateType& eur_rates)
 {
-  { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_eur_rates_mutex);
+  //Already fetched? Served without waiting for any fetch in progress
+  std::shared_ptr<const AreaRateType> found_rates = FindEurRates(norwegian_day);
+  if (!found_rates)
+  {
+    //Concurrent callers for the same day share one fetch and its result
+    found_rates = m_fetch_flight.Do(norwegian_day.AsULong(), [this, &norwegian_day]() -> std::shared_ptr<const AreaRateType>
+      {
+        //Fetched by a flight that completed after our first lookup?
+        std::shared_ptr<const AreaRateType> fetched_rates = FindEurRates(norwegian_day);
+        if (!fetched_rates && FetchEurRates(norwegian_day))
+        {
+          fetched_rates = FindEurRates(norwegian_day);
+        }
+        return fetched_rates;
+      });
+  }
 
-    //Already fetched?
-    auto existing_rate = m_eur_rates.find(norwegian_day.AsULong());
-    if (existing_rate != m_eur_rates.end())
-    {
-      eur_rates = existing_rate->second;
-      return true;
-    }
-    
-    //Fetch rate!
-    if (!FetchEurRates(norwegian_day))
-        return false;
+  if (!found_rates)
+  {
+    return false;
+  }
+  eur_rates = *found_rates;
+  return true;
+}
 
-    //Has it been fetched?
-    existing_rate = m_eur_rates.find(norwegian_day.AsULong());
-    if (existing_rate == m_eur_rates.end())
+bool Spotprice::GetEurStatistics(const NorwegianDay& norwegian_day, std::shared_ptr<const PriceStatistics>& statistics)
+{
+  std::shared_ptr<const AreaRateType> eur_rates = FindEurRates(norwegian_day);
+  if (!eur_rates)
+  {
+    AreaRateType fetched_rates;
+    if (!GetEurRates(norwegian_day, fetched_rates))
     {
       return false;
     }
-  
-    //It has been fetched! Return it
-    eur_rates = (*existing_rate).second;
+    eur_rates = FindEurRates(norwegian_day);
+    if (!eur_rates)
+    {
+      statistics = std::make_shared<const PriceStatistics>(fetched_rates, m_zones.GetSlotOffsets(norwegian_day, fetched_rates.GetResolutionMinutes())); //Not in the cache, so nothing to key the result on
+      return true;
+    }
+  }
+
+  const std::lock_guard<std::mutex> lock(m_statistics_mutex);
+  CachedStatistics& cached = m_statistics[norwegian_day.AsULong()];
+  if (cached.eur_rates != eur_rates)
+  {
+    cached.eur_rates = eur_rates;
+    cached.statistics = std::make_shared<const PriceStatistics>(*eur_rates, m_zones.GetSlotOffsets(norwegian_day, eur_rates->GetResolutionMinutes()));
+  }
+  statistics = cached.statistics;
+
+  while (m_statistics.size() > MAX_CACHED_STATISTICS)
+  {
+    m_statistics.erase(m_statistics.begin()); //Oldest day
   }
   return true;
 }
 
+void Spotprice::GetCachedEurRates(std::map<unsigned long, AreaRateType>& eur_rates) const
+{
+  std::shared_ptr<const RateMapType> cached_rates = m_eur_rates.load();
+  eur_rates.clear();
+  for (const auto& cached_rate : *cached_rates)
+  {
+    eur_rates.emplace_hint(eur_rates.end(), cached_rate.first, *cached_rate.second);
+  }
+}
+
+void Spotprice::SetCachedEurRates(const std::map<unsigned long, AreaRateType>& eur_rates)
+{
+  RateMapType new_rates;
+  for (const auto& eur_rate : eur_rates)
+  {
+    new_rates.emplace_hint(new_rates.end(), eur_rate.first, std::make_shared<const AreaRateType>(eur_rate.second));
+  }
+
+  const std::lock_guard<std::mutex> lock(m_fetch_mutex);
+  PublishEurRates(new_rates);
+}
+
+std::shared_ptr<const Spotprice::AreaRateType> Spotprice::FindEurRates(const NorwegianDay& norwegian_day) const
+{
+  std::shared_ptr<const RateMapType> cached_rates = m_eur_rates.load();
+  auto existing_rate = cached_rates->find(norwegian_day.AsULong());
+  return (existing_rate == cached_rates->end()) ? nullptr : existing_rate->second;
+}
+
+void Spotprice::PublishEurRates(const RateMapType& new_rates)
+{
+  if (new_rates.empty())
+  {
+    return;
+  }
+
+  //Only the day pointers are copied. Existing days are shared with the previous snapshot, which stays valid for readers still holding it
+  auto updated_rates = std::make_shared<RateMapType>(*m_eur_rates.load());
+  for (const auto& new_rate : new_rates)
+  {
+    updated_rates->insert_or_assign(new_rate.first, new_rate.second);
+  }
+  m_eur_rates.store(std::move(updated_rates));
+}
+
 bool Spotprice::FetchEurRates(const NorwegianDay& norwegian_day)
 {
-  { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_failmap_mutex);
-
-    //Remove expired failures
-    auto fail_expire_time = std::chrono::system_clock::now() - RETRY_DURATION;
-#if 0
-    std::erase_if(m_failmap, [fail_expire_time](const auto& item) {
-      auto const& [key, value] = item;
-      return value < fail_expire_time;
-    });
-#else
-    for (std::map<unsigned long, std::chrono::system_clock::time_point>::iterator it=m_failmap.begin(); it!=m_failmap.end(); ++it)
-    {
-        if (it->second < fail_expire_time)
-        {
-          m_failmap.erase(it);
-        }
+  if (!m_retry_scheduler.MayAttempt(norwegian_day.AsULong())) //Recently failed?
+  {
+    Poco::Logger::get(Logger::DEFAULT).information(std::string("Recently failed fetching spotprice for day ")+norwegian_day.ToString());
+    return false;
+  }
+
+  if (!FetchEurRateRange(norwegian_day, norwegian_day))
+  {
+    return RegisterFail(norwegian_day);
+  }
+
+  m_retry_scheduler.RegisterSuccess(norwegian_day.AsULong());
+  Poco::Logger::get(Logger::DEFAULT).information(std::string("Spotprice: Got all prices for ")+norwegian_day.ToString());
+  return true;
+}
+
+bool Spotprice::GetNextAttempt(const NorwegianDay& norwegian_day, RetryScheduler::TimePoint& next_attempt) const
+{
+  return m_retry_scheduler.GetNextAttempt(norwegian_day.AsULong(), next_attempt);
+}
+
+bool Spotprice::Backfill(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  bool status = true;
+  for (NorwegianDay chunk_first_day=first_day; !(last_day<chunk_first_day); chunk_first_day=chunk_first_day.IncrementDaysCopy(MAX_DAYS_PER_REQUEST))
+  {
+    NorwegianDay chunk_last_day = chunk_first_day.IncrementDaysCopy(MAX_DAYS_PER_REQUEST-1);
+    if (last_day < chunk_last_day)
+    {
+      chunk_last_day = last_day;
     }
-#endif
 
-    if (m_failmap.find(norwegian_day.AsULong()) != m_failmap.end()) //Recently failed?
+    if (FetchEurRateRange(chunk_first_day, chunk_last_day))
     {
-      Poco::Logger::get(Logger::DEFAULT).information(std::string("Recently failed fetching spotprice for day ")+norwegian_day.ToString());
-      return false;
+      Poco::Logger::get(Logger::DEFAULT).information(std::string("Spotprice: Backfilled ")+chunk_first_day.ToString()+" - "+chunk_last_day.ToString());
+    }
+    else
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Spotprice: Backfill incomplete for ")+chunk_first_day.ToString()+" - "+chunk_last_day.ToString());
+      status = false;
     }
   }
+  return status;
+}
 
-  std::string xml_buffer;
-  Poco::XML::NodeList* points = nullptr;
-  try
+bool Spotprice::FetchEurRateRange(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  //Days already cached are skipped. The rest keep per-area results between (partially failed) attempts
+  std::shared_ptr<const RateMapType> cached_rates = m_eur_rates.load();
+  std::vector<NorwegianDay> missing_days;
+  for (NorwegianDay day=first_day; !(last_day<day); day=day.IncrementDaysCopy(1))
   {
-    AreaRateType area_rates;
-    
-    for (std::array<Area,5>::size_type area_index=0; area_index<m_areas.size(); area_index++)
+    if (cached_rates->find(day.AsULong()) == cached_rates->end())
     {
-      Poco::URI uri(fmt::sprintf(DAYAHEAD_URL, ::GetApp()->GetConfig(Elspot::ENTSOE_TOKEN_PROPERTY), m_areas[area_index].code, m_areas[area_index].code, norwegian_day.AsULong(), norwegian_day.AsULong()));
-
-      const std::shared_ptr<Networking> networking = ::GetApp()->GetNetworking();
-      if (!networking.get())
-      {
-        return false;
-      }
-      std::shared_ptr<Poco::Net::HTTPSClientSession> session = networking->CreateSession(uri);
-      networking->CallGET(session, uri, "application/xml");
-
-      DayRateType area_prices;
-      Poco::Net::HTTPResponse res;
-      Poco::XML::DOMParser dom_parser;
-      Poco::XML::InputSource xml_src(session->receiveResponse(res));
-      if (Poco::Net::HTTPResponse::HTTP_OK != res.getStatus())
-      {
-        return RegisterFail(norwegian_day);
-      }
+      missing_days.push_back(day);
+    }
+  }
 
-      xml_buffer = std::string(std::istreambuf_iterator<char>(*xml_src.getByteStream()), {});
-      if (xml_buffer.empty())
+  //Only fetch areas not already fetched for all missing days
+  std::vector<std::size_t> missing_areas;
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_fetch_mutex);
+    for (std::size_t area_index=0; area_index<m_zones.size(); area_index++)
+    {
+      for (const NorwegianDay& day : missing_days)
       {
-        Poco::Logger::get(Logger::DEFAULT).error(std::string("Spotprice: Got 0 bytes for ")+uri.toString());
-        return RegisterFail(norwegian_day);
+        if (!GetPartialAreaRates(day).fetched[area_index])
+        {
+          missing_areas.push_back(area_index);
+          break;
+        }
       }
+    }
+  }
 
-      Poco::AutoPtr<Poco::XML::Document> xml_doc = dom_parser.parseString(xml_buffer);
+  //Requests are spread by the shared rate limiter. Today goes ahead of tomorrow, which goes ahead of backfill
+  RateLimiter::Priority priority = FetchPriority(first_day, last_day);
+  int max_concurrent_requests = ::GetApp()->GetConfigInt(Elspot::ENTSOE_MAX_CONCURRENT_REQUESTS_PROPERTY, DEFAULT_MAX_CONCURRENT_REQUESTS);
+  std::size_t worker_count = std::min(missing_areas.size(), static_cast<std::size_t>(std::max(max_concurrent_requests, 1)));
 
-      //Check curveType
-      Poco::XML::NodeList* curve_types = xml_doc->getElementsByTagName("curveType");
-      if (curve_types==nullptr || curve_types->length()==0)
-      {
-        Poco::Logger::get(Logger::DEFAULT).information(std::string("Did not get a curveType"));
-      } else {
-        Poco::XML::Node* curve_type = curve_types->item(0);
-        std::string curve_type_value = curve_type->innerText();
-        if (curve_type_value!="A01" && curve_type_value!="A03")
+  std::vector<std::map<unsigned long, DayRateType>> fetched_rates(missing_areas.size());
+  std::atomic<std::size_t> next_missing_area{0};
+  { //Worker scope. jthreads join when leaving scope
+    std::vector<std::jthread> workers;
+    for (std::size_t worker=0; worker<worker_count; worker++)
+    {
+      workers.emplace_back([this, &first_day, &last_day, &missing_areas, &fetched_rates, &next_missing_area, priority]()
         {
-          Poco::Logger::get(Logger::DEFAULT).information(std::string("Got curveType "+curve_type_value));
-        }
-      }
-      if (curve_types) curve_types->release();
+          for (auto missing_index=next_missing_area++; missing_index<missing_areas.size(); missing_index=next_missing_area++)
+          {
+            m_rate_limiter.Acquire(priority);
+            (void)FetchAreaEurRates(first_day, last_day, missing_areas[missing_index], fetched_rates[missing_index]); //Keep any complete days, even on failure
+          }
+        });
+    }
+  }
 
-      //Check resolution
-      Poco::XML::NodeList* resolutions = xml_doc->getElementsByTagName("resolution");
-      if (resolutions==nullptr || resolutions->length()==0)
+  bool status = true;
+  RateMapType completed_rates;
+  { //Lock scope
+    const std::lock_guard<std::mutex> lock(m_fetch_mutex);
+    for (const NorwegianDay& day : missing_days)
+    {
+      PartialAreaRates& partial_rates = GetPartialAreaRates(day);
+      for (std::size_t missing_index=0; missing_index<missing_areas.size(); missing_index++)
       {
-        Poco::Logger::get(Logger::DEFAULT).information(std::string("Did not get a resolution"));
-      } else {
-        Poco::XML::Node* resolution = resolutions->item(0);
-        std::string resolution_value = resolution->innerText();
-        if (resolution_value!="PT60M")
+        auto fetched_day = fetched_rates[missing_index].find(day.AsULong());
+        if (fetched_day != fetched_rates[missing_index].end())
         {
-          Poco::Logger::get(Logger::DEFAULT).information(std::string("Got resolution "+resolution_value));
+          partial_rates.rates[missing_areas[missing_index]] = fetched_day->second;
+          if (!partial_rates.fetched[missing_areas[missing_index]])
+          {
+            partial_rates.fetched[missing_areas[missing_index]] = true;
+            partial_rates.fetched_count++;
+          }
         }
       }
-      if (resolutions) resolutions->release();
 
-      //Find start time
-      std::string start_value;
-      Poco::XML::NodeList* starts = xml_doc->getElementsByTagName("start");
-      if (starts==nullptr || starts->length()==0)
+      AreaRateType area_rates;
+      if (partial_rates.fetched_count==m_zones.size() && CombineAreaRates(partial_rates, area_rates))
       {
-        Poco::Logger::get(Logger::DEFAULT).error(std::string("Did not get a start time"));
-      } else {
-        Poco::XML::Node* start = starts->item(0);
-        start_value = start->innerText();
+        completed_rates[day.AsULong()] = std::make_shared<const AreaRateType>(std::move(area_rates));
+        m_partial_eur_rates.erase(day.AsULong());
       }
-      if (starts) starts->release();
-      if (start_value.empty())
+      else
       {
-        return RegisterFail(norwegian_day);
+        Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("Spotprice: Got %u of %u areas for %s", partial_rates.fetched_count, m_zones.size(), day.ToString()));
+        status = false;
       }
-      UTCTime start_time_utc(start_value);
+    }
+    PublishEurRates(completed_rates);
 
-      points = xml_doc->getElementsByTagName("Point");
-      for (unsigned long point_index=0; point_index<points->length(); point_index++)
-      {
-        Poco::XML::Node* point = points->item(point_index);
-        if (point->nodeType() == Poco::XML::Node::ELEMENT_NODE)
-        {
-          Poco::XML::Element* position = static_cast<Poco::XML::Element*>(point)->getChildElement("position");
-          Poco::XML::Element* price_amount = static_cast<Poco::XML::Element*>(point)->getChildElement("price.amount");
-          if (position && price_amount)
-          {
-            std::string position_value = position->innerText();
-            std::string price_amount_value = price_amount->innerText();
-            if (!position_value.empty() && !price_amount_value.empty())
-            {
-              unsigned int position_hour = std::stoi(position_value) - 1;
-              double price = std::stod(price_amount_value);
-
-              //Both curveType A01 and A03 can work if we fill array from current position and to the end
-              for (; position_hour<(points->length()); position_hour++)
-              {
-                NorwegianTime local_time = start_time_utc.IncrementHoursCopy(position_hour).AsNorwegianTime();
-                if (norwegian_day == local_time)
-                {
-                  area_prices[local_time.GetHour()] = price;
-                }
-              }
-            }
-          }
-        }
-      }
-      area_rates[area_index] = area_prices;
+    //Only today and tomorrow are retried for long. Older days that keep failing (like a zone without a publication) would otherwise pile up
+    m_partial_eur_rates.erase(m_partial_eur_rates.begin(), m_partial_eur_rates.lower_bound(NorwegianDay::Today().IncrementDaysCopy(-1).AsULong()));
+  }
 
-      points->release();
-      points = nullptr;
-    }
+  if (!completed_rates.empty())
+  {
+    ::GetApp()->SaveSnapshot(); //Outside m_fetch_mutex. Saving reads the published snapshot only
+  }
+  return status;
+}
 
-    m_eur_rates[norwegian_day.AsULong()] = area_rates;
-    
-    Poco::Logger::get(Logger::DEFAULT).information(std::string("Spotprice: Got all prices for ")+norwegian_day.ToString());
-    return true;
+Spotprice::PartialAreaRates& Spotprice::GetPartialAreaRates(const NorwegianDay& norwegian_day)
+{
+  PartialAreaRates& partial_rates = m_partial_eur_rates[norwegian_day.AsULong()];
+  if (partial_rates.fetched.size() != m_zones.size())
+  {
+    partial_rates.rates.assign(m_zones.size(), DayRateType());
+    partial_rates.fetched.assign(m_zones.size(), false);
+    partial_rates.fetched_count = 0;
   }
-  catch (Poco::Exception& ex)
+  return partial_rates;
+}
+
+RateLimiter::Priority Spotprice::FetchPriority(const NorwegianDay& first_day, const NorwegianDay& last_day)
+{
+  NorwegianDay norwegian_today = NorwegianDay::Today(); //Same "today" as the pruning of partial results
+  NorwegianDay norwegian_tomorrow = norwegian_today.IncrementDaysCopy(1);
+  if (!(norwegian_today < first_day) && !(last_day < norwegian_today))
   {
-    Poco::Logger::get(Logger::DEFAULT).error(ex.message());
-    if (!xml_buffer.empty())
+    return RateLimiter::Priority::TODAY;
+  }
+  if (!(norwegian_tomorrow < first_day) && !(last_day < norwegian_tomorrow))
+  {
+    return RateLimiter::Priority::TOMORROW;
+  }
+  return RateLimiter::Priority::BACKFILL;
+}
+
+bool Spotprice::FetchAreaEurRates(const NorwegianDay& first_day, const NorwegianDay& last_day, std::size_t area_index, std::map<unsigned long, DayRateType>& area_prices) const
+{
+  //Keep the start of the response body, to be logged if it can not be parsed
+  PrefixBuffer xml_prefix(MAX_LOGGED_RESPONSE_SIZE);
+  std::ostream xml_prefix_stream(&xml_prefix);
+  try
+  {
+    const Timezone& timezone = *m_zones[area_index].timezone;
+    UTCTime period_start = first_day.StartAsUTCTime(timezone);
+    UTCTime period_end = last_day.IncrementDaysCopy(1).StartAsUTCTime(timezone);
+    Poco::URI uri(fmt::sprintf(DAYAHEAD_URL, ::GetApp()->GetConfig(Elspot::ENTSOE_TOKEN_PROPERTY), m_zones[area_index].code, m_zones[area_index].code,
+                               period_start.GetYear(), period_start.GetMonth(), period_start.GetDay(), period_start.GetHour(), period_start.GetMinute(),
+                               period_end.GetYear(), period_end.GetMonth(), period_end.GetDay(), period_end.GetHour(), period_end.GetMinute()));
+
+    const std::shared_ptr<Networking> networking = ::GetApp()->GetNetworking();
+    if (!networking.get())
+    {
+      return false;
+    }
+    std::shared_ptr<Poco::Net::HTTPSClientSession> session = networking->CreateSession(uri);
+    networking->CallGET(session, uri, "application/xml");
+
+    Poco::Net::HTTPResponse res;
+    std::unique_ptr<ResponseBody> response_body = Networking::ReceiveResponse(session, res);
+    std::istream& response_stream = response_body->Stream(); //Already inflated, if the response was compressed
+    if (Poco::Net::HTTPResponse::HTTP_OK != res.getStatus())
+    {
+      return false;
+    }
+
+    PublicationParser parser(first_day, last_day, timezone);
+    Poco::TeeInputStream tee_stream(response_stream);
+    tee_stream.addStream(xml_prefix_stream);
+    parser.Parse(tee_stream);
+    response_body->Drain();
+    networking->ReleaseSession(uri, session); //Response has been read completely. Keep connection warm for next request
+
+    bool status = true;
+    for (NorwegianDay day=first_day; !(last_day<day); day=day.IncrementDaysCopy(1))
     {
-      Poco::Logger::get(Logger::DEFAULT).error(xml_buffer);
+      DayRateType day_prices;
+      if (parser.GotPrices(day, day_prices))
+      {
+        area_prices[day.AsULong()] = day_prices;
+      }
+      else
+      {
+        Poco::Logger::get(Logger::DEFAULT).error(fmt::sprintf("Spotprice: Got no prices for %s in %s", m_zones[area_index].id, day.ToString()));
+        status = false;
+      }
     }
-    
-    if (points)
+    return status;
+  }
+  catch (Poco::Exception& ex)
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(ex.displayText());
+    if (!xml_prefix.Prefix().empty())
     {
-      points->release();
+      Poco::Logger::get(Logger::DEFAULT).error(xml_prefix.Prefix());
     }
   }
   catch (...)
   {
     Poco::Logger::get(Logger::DEFAULT).error("Got spotprice exception");
-    if (points)
+  }
+  return false;
+}
+
+bool Spotprice::CombineAreaRates(const PartialAreaRates& partial_rates, AreaRateType& area_rates) const
+{
+  if (partial_rates.rates.empty() || partial_rates.rates.size()!=m_zones.size())
+  {
+    return false;
+  }
+
+  unsigned int resolution_minutes = partial_rates.rates[0].resolution_minutes;
+  for (const DayRateType& day_rates : partial_rates.rates)
+  {
+    resolution_minutes = std::min(resolution_minutes, day_rates.resolution_minutes);
+  }
+
+  //Every area must cover the same day. The longest area decides, so an area with a partial day is the one logged
+  std::vector<std::size_t> area_slot_counts(m_zones.size());
+  for (std::size_t area_index=0; area_index<m_zones.size(); area_index++)
+  {
+    const DayRateType& day_rates = partial_rates.rates[area_index];
+    if (0==resolution_minutes || 0!=day_rates.resolution_minutes%resolution_minutes)
     {
-      points->release();
+      Poco::Logger::get(Logger::DEFAULT).error(fmt::sprintf("Spotprice: Resolution %u for %s does not fit in %u minute slots", day_rates.resolution_minutes, m_zones[area_index].id, resolution_minutes));
+      return false;
     }
+    area_slot_counts[area_index] = day_rates.prices.size() * (day_rates.resolution_minutes / resolution_minutes);
   }
-  return RegisterFail(norwegian_day);
+
+  std::size_t slot_count = *std::max_element(area_slot_counts.begin(), area_slot_counts.end());
+  for (std::size_t area_index=0; area_index<m_zones.size(); area_index++)
+  {
+    if (area_slot_counts[area_index] != slot_count)
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(fmt::sprintf("Spotprice: Got %u %u minute slots for %s, but %u for other areas", area_slot_counts[area_index], resolution_minutes, m_zones[area_index].id, slot_count));
+      return false;
+    }
+  }
+
+  area_rates = AreaRateType(resolution_minutes, slot_count, m_zones.size());
+  for (std::size_t area_index=0; area_index<m_zones.size(); area_index++)
+  {
+    if (!area_rates.SetArea(area_index, partial_rates.rates[area_index].resolution_minutes, partial_rates.rates[area_index].prices))
+    {
+      return false; //Resolution and slot count are checked above
+    }
+  }
+  return true;
 }
 
 bool Spotprice::RegisterFail(const NorwegianDay& norwegian_day)
 {
-  { //Lock scope
-    const std::lock_guard<std::mutex> lock(m_failmap_mutex);
-
-    m_failmap.insert({norwegian_day.AsULong(), std::chrono::system_clock::now()});
-  }
-  
+  RetryScheduler::TimePoint next_attempt = m_retry_scheduler.RegisterFail(norwegian_day.AsULong());
+  Poco::Logger::get(Logger::DEFAULT).information(fmt::sprintf("Spotprice: Retry %s in %d seconds",
+                                                 norwegian_day.ToString(),
+                                                 std::chrono::duration_cast<std::chrono::seconds>(next_attempt - std::chrono::system_clock::now()).count()));
   return false;
 }
@@ -1,61 +1,98 @@
 #ifndef _SPOTPRICE_H_
 #define _SPOTPRICE_H_
 
-#include <array>
+#include <atomic>
 #include <chrono>
 #include <map>
+#include <memory>
 #include <mutex>
-
-#include <Poco/DOM/Node.h>
+#include <vector>
 
 #include "day.h"
-
-
-struct Area
-{
-  const char* id;
-  const char* code;
-  const char* name;
-};
+#include "priceseries.h"
+#include "ratelimiter.h"
+#include "retry.h"
+#include "singleflight.h"
+#include "statistics.h"
+#include "zones.h"
 
 
 class Spotprice
 {
 public:
+  Spotprice();
+  Spotprice(const ZoneCatalogue& zones, unsigned int requests_per_minute);
   virtual ~Spotprice() = default;
 
 private:
-  static constexpr std::chrono::minutes RETRY_DURATION = std::chrono::minutes(10);
-  static constexpr const char* DAYAHEAD_URL = "https://web-api.tp.entsoe.eu/api?securityToken=%s&documentType=A44&in_Domain=%s&out_Domain=%s&periodStart=%08lu1200&periodEnd=%08lu1300"; //Ask for only one hour mid-day. We will get entire day
+  static constexpr std::chrono::minutes INITIAL_RETRY_DELAY = std::chrono::minutes(2);
+  static constexpr std::chrono::minutes MAX_RETRY_DELAY = std::chrono::minutes(30);
+  static constexpr int DEFAULT_MAX_CONCURRENT_REQUESTS = 5;
+  static constexpr unsigned int RATE_LIMIT_BURST = 10;
+  static constexpr const char* DAYAHEAD_URL = "https://web-api.tp.entsoe.eu/api?securityToken=%s&documentType=A44&in_Domain=%s&out_Domain=%s&periodStart=%04u%02u%02u%02u%02u&periodEnd=%04u%02u%02u%02u%02u"; //periodStart and periodEnd are yyyyMMddHHmm UTC
+  static constexpr std::time_t MAX_DAYS_PER_REQUEST = 365; //Entso-E will not return more than one year per request
+  static constexpr std::size_t MAX_CACHED_STATISTICS = 8; //Days. Normally only today and tomorrow are asked for
+  static constexpr std::size_t MAX_LOGGED_RESPONSE_SIZE = 4*1024; //Bytes of a response body logged when it can not be parsed
 
 public:
-  static constexpr int HOURS_PER_DAY = 24;
-  static constexpr std::array<Area,5> m_areas
-    {{
-      {"NO-1", "10YNO-1--------2", "Oslo"},
-      {"NO-2", "10YNO-2--------T", "Kristiansand"},
-      {"NO-3", "10YNO-3--------J", "Trondheim"},
-      {"NO-4", "10YNO-4--------9", "Tromsø"},
-      {"NO-5", "10Y1001A1001A48H", "Bergen"}
-    }};
-    typedef std::array<double,HOURS_PER_DAY> DayRateType;
-    typedef std::array<DayRateType,m_areas.size()> AreaRateType;
+  static constexpr unsigned int DEFAULT_REQUESTS_PER_MINUTE = 400; //ENTSO-E allows 400 requests per minute per user
+  typedef DayPrices DayRateType;
+  typedef PriceSeries AreaRateType;
+
+private:
+  struct PartialAreaRates
+  {
+    std::vector<DayRateType> rates; //One per zone
+    std::vector<bool> fetched;
+    std::size_t fetched_count = 0;
+  };
+  typedef std::map<unsigned long, std::shared_ptr<const AreaRateType>> RateMapType; //Immutable once published in m_eur_rates
+
+  struct CachedStatistics
+  {
+    std::shared_ptr<const AreaRateType> eur_rates; //Computed from these. Stale once the day is refetched
+    std::shared_ptr<const PriceStatistics> statistics;
+  };
 
 public:
   [[nodiscard]] virtual bool HasEurRate(const NorwegianDay& norwegian_day) const;
   [[nodiscard]] virtual bool CacheEurRates(const NorwegianDay& norwegian_day);
   [[nodiscard]] virtual bool GetEurRates(const NorwegianDay& norwegian_day, AreaRateType& eur_rates);
+  [[nodiscard]] virtual bool GetEurStatistics(const NorwegianDay& norwegian_day, std::shared_ptr<const PriceStatistics>& statistics); //Computed once per fetched day
+  [[nodiscard]] virtual bool Backfill(const NorwegianDay& first_day, const NorwegianDay& last_day);
+  [[nodiscard]] const ZoneCatalogue& GetZones() const {return m_zones;}
+
+  [[nodiscard]] bool GetNextAttempt(const NorwegianDay& norwegian_day, RetryScheduler::TimePoint& next_attempt) const; //False if not backing off after a failed fetch
+
+  void GetCachedEurRates(std::map<unsigned long, AreaRateType>& eur_rates) const;
+  void SetCachedEurRates(const std::map<unsigned long, AreaRateType>& eur_rates);
   
 private:
-  [[nodiscard]] virtual bool FetchEurRates(const NorwegianDay& norwegian_day); //Not thread-safe funtion. Call from within locked m_eur_rates_mutex
+  [[nodiscard]] virtual bool FetchEurRates(const NorwegianDay& norwegian_day);
+  [[nodiscard]] virtual bool FetchEurRateRange(const NorwegianDay& first_day, const NorwegianDay& last_day); //Holds m_fetch_mutex for bookkeeping only, never during requests
+  [[nodiscard]] virtual bool FetchAreaEurRates(const NorwegianDay& first_day, const NorwegianDay& last_day, std::size_t area_index, std::map<unsigned long, DayRateType>& area_prices) const; //Thread-safe. Called concurrently for different areas
   [[nodiscard]] virtual bool RegisterFail(const NorwegianDay& norwegian_day);
+  [[nodiscard]] bool CombineAreaRates(const PartialAreaRates& partial_rates, AreaRateType& area_rates) const; //Combine at the finest resolution of any area
+  [[nodiscard]] PartialAreaRates& GetPartialAreaRates(const NorwegianDay& norwegian_day); //Call from within locked m_fetch_mutex
+  [[nodiscard]] static RateLimiter::Priority FetchPriority(const NorwegianDay& first_day, const NorwegianDay& last_day);
+  [[nodiscard]] std::shared_ptr<const AreaRateType> FindEurRates(const NorwegianDay& norwegian_day) const; //Lock-free lookup in the current snapshot. nullptr if not cached
+  void PublishEurRates(const RateMapType& new_rates); //Copy-on-write. Call from within locked m_fetch_mutex
 
 private:
-  std::map<unsigned long, AreaRateType> m_eur_rates;
-  mutable std::mutex m_eur_rates_mutex;
+  const ZoneCatalogue m_zones;
+  RateLimiter m_rate_limiter; //Shared by all requests to ENTSO-E
+
+private:
+  //Readers load the current snapshot and never wait for a fetch. Writers serialize on m_fetch_mutex and swap in a new map
+  std::atomic<std::shared_ptr<const RateMapType>> m_eur_rates;
+  std::map<unsigned long, PartialAreaRates> m_partial_eur_rates; //Areas fetched for incomplete days from yesterday on. Guarded by m_fetch_mutex
+  std::mutex m_fetch_mutex; //Guards m_partial_eur_rates and publishing to m_eur_rates
+  SingleFlight<unsigned long, std::shared_ptr<const AreaRateType>> m_fetch_flight; //Keyed on NorwegianDay::AsULong()
+
+  RetryScheduler m_retry_scheduler;
 
-  std::map<unsigned long, std::chrono::system_clock::time_point> m_failmap;
-  std::mutex m_failmap_mutex;
+  std::map<unsigned long, CachedStatistics> m_statistics; //Guarded by m_statistics_mutex
+  std::mutex m_statistics_mutex;
 };
 
 #endif // _SPOTPRICE_H_
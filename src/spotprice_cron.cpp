@@ -1,34 +1,79 @@
 #include "spotprice_cron.h"
 
+#include <algorithm>
 #include <condition_variable>
 
+#include <fmt/printf.h>
+
 #include "application.h"
 #include "day.h"
+#include "retry.h"
 
 
 std::condition_variable_any spotprice_cv;
 std::mutex spotprice_mutex;
 
+static constexpr std::chrono::minutes CRON_INITIAL_RETRY_DELAY = std::chrono::minutes(1);
+static constexpr std::chrono::minutes CRON_MAX_RETRY_DELAY = std::chrono::minutes(20);
+
+
+static void save_snapshot(const NorwegianDay& most_recent_norwegian_today, const NorwegianDay& most_recent_norwegian_tomorrow)
+{
+  const std::shared_ptr<Snapshot> snapshot = ::GetApp()->GetSnapshot();
+  if (snapshot.get())
+  {
+    snapshot->SetPublishedDays(most_recent_norwegian_today, most_recent_norwegian_tomorrow);
+    ::GetApp()->SaveSnapshot();
+  }
+}
 
 void spotprice_cron(std::stop_token token)
 {
-  bool first = true;
+  bool poll_now = true;
   bool failed = false;
+  NorwegianDay failed_day = UTCTime(0).AsNorwegianDay();
+  RetryScheduler retry_scheduler(CRON_INITIAL_RETRY_DELAY, CRON_MAX_RETRY_DELAY);
   NorwegianDay most_recent_norwegian_today = UTCTime(0).AsNorwegianDay();
   NorwegianDay most_recent_norwegian_tomorrow = UTCTime(0).AsNorwegianDay();
 
+  //After a restart, do not fetch and publish again what was published before the restart
+  const std::shared_ptr<Snapshot> snapshot = ::GetApp()->GetSnapshot();
+  if (snapshot.get() && snapshot->GetPublishedDays(most_recent_norwegian_today, most_recent_norwegian_tomorrow))
+  {
+    Poco::Logger::get(Logger::DEFAULT).information("Restored published days from snapshot");
+
+    //GotPrices is not called again for these days, so give MQTT what it would have kept from it
+    for (const NorwegianDay& published_day : {most_recent_norwegian_today, most_recent_norwegian_tomorrow})
+    {
+      if (!(published_day < NorwegianDay::Today()) && !::GetApp()->GetMQTT()->RestorePrices(published_day))
+      {
+        Poco::Logger::get(Logger::DEFAULT).warning(std::string("MQTT could not restore prices for ")+published_day.ToString());
+      }
+    }
+  }
+
   while(!token.stop_requested())
   {
     if (failed)
     {
-      Poco::Logger::get(Logger::DEFAULT).warning("Waiting 5 minutes because of previous fail");
+      //Back off, but never retry before Spotprice itself is ready to fetch the failed day again
+      RetryScheduler::TimePoint next_attempt = retry_scheduler.RegisterFail(failed_day.AsULong());
+      RetryScheduler::TimePoint spotprice_next_attempt;
+      if (::GetApp()->GetSpotprice()->GetNextAttempt(failed_day, spotprice_next_attempt))
+      {
+        next_attempt = std::max(next_attempt, spotprice_next_attempt);
+      }
+
+      Poco::Logger::get(Logger::DEFAULT).warning(fmt::sprintf("Waiting %d seconds because of previous fail",
+                                                 std::chrono::duration_cast<std::chrono::seconds>(next_attempt - std::chrono::system_clock::now()).count()));
       std::unique_lock<std::mutex> lock(spotprice_mutex);
-      if (spotprice_cv.wait_for(lock, token, std::chrono::minutes(5), [token]{return token.stop_requested();}))
+      if (spotprice_cv.wait_until(lock, token, next_attempt, [token]{return token.stop_requested();}))
       {
         Poco::Logger::get(Logger::DEFAULT).warning("Stop requested");
         return;
       }
       failed = false;
+      poll_now = true; //Backoff already waited. Do not wait for the next 20 minute poll as well
     }
 
     UTCTime now;
@@ -43,11 +88,14 @@ void spotprice_cron(std::stop_token token)
           ::GetApp()->GetSVG()->GenerateSVGs(norwegian_today))
       {
         most_recent_norwegian_today = norwegian_today;
+        retry_scheduler.RegisterSuccess(norwegian_today.AsULong());
+        save_snapshot(most_recent_norwegian_today, most_recent_norwegian_tomorrow);
       }
       else
       {
         Poco::Logger::get(Logger::DEFAULT).error("Caching spotprice for today failed");
         failed = true;
+        failed_day = norwegian_today;
         continue;
       }
     }
@@ -76,7 +124,7 @@ void spotprice_cron(std::stop_token token)
     {
       if (most_recent_norwegian_today!=norwegian_today || most_recent_norwegian_tomorrow!=norwegian_tomorrow)
       {
-        if (!first)
+        if (!poll_now)
         {
           poll_time = UTCTime().IncrementSecondsCopy(20*60);
           poll_time.SetMinute(static_cast<uint8_t>((poll_time.GetMinute()/20)*20)); //Integer division to round down to 00|20|40
@@ -97,7 +145,7 @@ void spotprice_cron(std::stop_token token)
           continue;
         }
         
-        first = false;
+        poll_now = false;
         
         //Are we STILL not having todays prices? Keep on trying..
         if (most_recent_norwegian_today != norwegian_today)
@@ -107,11 +155,14 @@ void spotprice_cron(std::stop_token token)
               ::GetApp()->GetSVG()->GenerateSVGs(norwegian_today))
           {
             most_recent_norwegian_today = norwegian_today;
+            retry_scheduler.RegisterSuccess(norwegian_today.AsULong());
+            save_snapshot(most_recent_norwegian_today, most_recent_norwegian_tomorrow);
           }
           else
           {
             Poco::Logger::get(Logger::DEFAULT).error("Caching spotprice for today failed again");
             failed = true;
+            failed_day = norwegian_today;
             continue;
           }
         }
@@ -125,11 +176,14 @@ void spotprice_cron(std::stop_token token)
               ::GetApp()->GetSVG()->GenerateSVGs(norwegian_tomorrow))
           {
             most_recent_norwegian_tomorrow = norwegian_tomorrow;
+            retry_scheduler.RegisterSuccess(norwegian_tomorrow.AsULong());
+            save_snapshot(most_recent_norwegian_today, most_recent_norwegian_tomorrow);
           }
           else
           {
             Poco::Logger::get(Logger::DEFAULT).error("Caching spotprice for tomorrow failed at " + now.AsNorwegianTime().ToString());
             failed = true;
+            failed_day = norwegian_tomorrow;
             continue;
           }
         }
@@ -0,0 +1,140 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+
+PriceStatistics::PriceStatistics(const PriceSeries& prices, std::span<const long> slot_offsets)
+: m_zones(prices.GetAreaCount())
+{
+  const std::size_t slot_count = prices.GetSlotCount();
+  if (0 == slot_count)
+  {
+    m_zones.clear();
+    return;
+  }
+
+  //Slots of area 0 covered by every area, for the mean spread
+  const long signed_slot_count = static_cast<long>(slot_count);
+  long shared_first_slot = 0;
+  long shared_end_slot = signed_slot_count;
+  for (long slot_offset : slot_offsets)
+  {
+    shared_first_slot = std::max(shared_first_slot, slot_offset);
+    shared_end_slot = std::min(shared_end_slot, signed_slot_count+slot_offset);
+  }
+  std::vector<double> shared_means(prices.GetAreaCount(), 0.0);
+
+  //Cross-area envelope, for the spreads. Indexed like the slots of area 0
+  std::vector<double> slot_min(slot_count, std::numeric_limits<double>::infinity());
+  std::vector<double> slot_max(slot_count, -std::numeric_limits<double>::infinity());
+  std::vector<double> sorted(slot_count);
+  for (std::size_t area_index=0; area_index<prices.GetAreaCount(); area_index++)
+  {
+    std::span<const double> area_prices = prices[area_index];
+    Zone& zone = m_zones[area_index];
+
+    //Sum, min and max in one branch-free pass over the contiguous block. The slots are looked up afterwards
+    double sum = 0.0;
+    double min = area_prices[0];
+    double max = area_prices[0];
+    for (std::size_t slot=0; slot<slot_count; slot++)
+    {
+      double price = area_prices[slot];
+      sum += price;
+      min = std::min(min, price);
+      max = std::max(max, price);
+    }
+    //Slot n of this area is slot n+slot_offset of area 0 in UTC. Areas in other timezones start and end their day at other hours
+    const long slot_offset = (area_index < slot_offsets.size()) ? slot_offsets[area_index] : 0;
+    const std::size_t first_slot = static_cast<std::size_t>(std::clamp(slot_offset, 0L, signed_slot_count));
+    const std::size_t end_slot = static_cast<std::size_t>(std::clamp(signed_slot_count+slot_offset, 0L, signed_slot_count));
+    for (std::size_t slot=first_slot; slot<end_slot; slot++)
+    {
+      double price = area_prices[static_cast<std::size_t>(static_cast<long>(slot)-slot_offset)];
+      slot_min[slot] = std::min(slot_min[slot], price);
+      slot_max[slot] = std::max(slot_max[slot], price);
+    }
+    if (shared_first_slot < shared_end_slot)
+    {
+      auto shared_prices = area_prices.subspan(static_cast<std::size_t>(shared_first_slot-slot_offset), static_cast<std::size_t>(shared_end_slot-shared_first_slot));
+      shared_means[area_index] = std::accumulate(shared_prices.begin(), shared_prices.end(), 0.0)/static_cast<double>(shared_prices.size());
+    }
+
+    zone.mean = sum/static_cast<double>(slot_count);
+    zone.min = min;
+    zone.max = max;
+    zone.min_slot = static_cast<unsigned int>(std::find(area_prices.begin(), area_prices.end(), min) - area_prices.begin());
+    zone.max_slot = static_cast<unsigned int>(std::find(area_prices.begin(), area_prices.end(), max) - area_prices.begin());
+
+    //Second pass while the prices are still in cache. Two-pass variance does not lose precision like sum of squares does
+    double squared_deviations = 0.0;
+    for (std::size_t slot=0; slot<slot_count; slot++)
+    {
+      double deviation = area_prices[slot] - zone.mean;
+      squared_deviations += deviation*deviation;
+    }
+    zone.standard_deviation = std::sqrt(squared_deviations/static_cast<double>(slot_count));
+
+    std::copy(area_prices.begin(), area_prices.end(), sorted.begin());
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double fraction)
+      {
+        double position = fraction*static_cast<double>(sorted.size()-1);
+        std::size_t lower = static_cast<std::size_t>(position);
+        std::size_t upper = std::min(lower+1, sorted.size()-1);
+        return sorted[lower] + (position-static_cast<double>(lower))*(sorted[upper]-sorted[lower]);
+      };
+    zone.median = percentile(0.5);
+    for (std::size_t index=0; index<PERCENTILES.size(); index++)
+    {
+      zone.percentiles[index] = percentile(PERCENTILES[index]/100.0);
+    }
+  }
+
+  m_slot_spreads.resize(slot_count);
+  for (std::size_t slot=0; slot<slot_count; slot++)
+  {
+    m_slot_spreads[slot] = (slot_min[slot] <= slot_max[slot]) ? slot_max[slot] - slot_min[slot] : 0.0; //No area covers the slot if offsets are off
+  }
+
+  auto mean_range = std::minmax_element(shared_means.begin(), shared_means.end());
+  m_mean_spread = shared_means.empty() ? 0.0 : *mean_range.second - *mean_range.first;
+}
+
+double PriceStatistics::GetMin() const
+{
+  auto zone = std::min_element(m_zones.begin(), m_zones.end(), [](const Zone& a, const Zone& b) {return a.min < b.min;});
+  return (zone == m_zones.end()) ? 0.0 : zone->min;
+}
+
+double PriceStatistics::GetMax() const
+{
+  auto zone = std::max_element(m_zones.begin(), m_zones.end(), [](const Zone& a, const Zone& b) {return a.max < b.max;});
+  return (zone == m_zones.end()) ? 0.0 : zone->max;
+}
+
+PriceStatistics PriceStatistics::Converted(double exchange_rate) const
+{
+  PriceStatistics converted(*this);
+  for (Zone& zone : converted.m_zones)
+  {
+    zone.mean *= exchange_rate;
+    zone.median *= exchange_rate;
+    zone.standard_deviation *= exchange_rate;
+    zone.min *= exchange_rate;
+    zone.max *= exchange_rate;
+    for (double& percentile : zone.percentiles)
+    {
+      percentile *= exchange_rate;
+    }
+  }
+  for (double& spread : converted.m_slot_spreads)
+  {
+    spread *= exchange_rate;
+  }
+  converted.m_mean_spread *= exchange_rate;
+  return converted;
+}
@@ -0,0 +1,52 @@
+#ifndef _STATISTICS_H_
+#define _STATISTICS_H_
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include "priceseries.h"
+
+
+//Figures derived from one day of prices for all areas, in the currency of the series they were computed from.
+//Everything is a price (or a slot), so statistics for another currency are a scaled copy, not a new computation
+class PriceStatistics
+{
+public:
+  static constexpr std::array<unsigned int, 4> PERCENTILES{10, 25, 75, 90};
+
+  struct Zone
+  {
+    double mean = 0.0;
+    double median = 0.0;
+    double standard_deviation = 0.0; //Population standard deviation over the slots
+    double min = 0.0;
+    double max = 0.0;
+    unsigned int min_slot = 0; //First slot with the min price
+    unsigned int max_slot = 0; //First slot with the max price
+    std::array<double, PERCENTILES.size()> percentiles{}; //Linear interpolation between closest ranks. Indexed like PERCENTILES
+  };
+
+public:
+  PriceStatistics() = default;
+  explicit PriceStatistics(const PriceSeries& prices) : PriceStatistics(prices, {}) {} //All areas in one timezone
+  PriceStatistics(const PriceSeries& prices, std::span<const long> slot_offsets); //Slots each area starts after area 0 in UTC, like ZoneCatalogue::GetSlotOffsets. Empty if all are 0
+
+public:
+  [[nodiscard]] std::size_t GetAreaCount() const {return m_zones.size();}
+  [[nodiscard]] const Zone& operator[](std::size_t area_index) const {return m_zones[area_index];}
+  [[nodiscard]] std::span<const double> GetSlotSpreads() const {return m_slot_spreads;} //Most expensive minus cheapest area, per slot of area 0. Areas are compared at the same UTC time, and left out where their day does not cover it
+  [[nodiscard]] double GetMeanSpread() const {return m_mean_spread;} //Highest minus lowest area mean over the slots shared by all areas in UTC
+  [[nodiscard]] double GetMin() const; //Over all areas
+  [[nodiscard]] double GetMax() const;
+
+  [[nodiscard]] PriceStatistics Converted(double exchange_rate) const; //exchange_rate must be positive, so the order of prices is kept
+
+private:
+  std::vector<Zone> m_zones;
+  std::vector<double> m_slot_spreads;
+  double m_mean_spread = 0.0;
+};
+
+#endif // _STATISTICS_H_
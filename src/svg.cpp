@@ -1,5 +1,6 @@
 #include "svg.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <cmath>
@@ -14,6 +15,10 @@
 
 #define FLOAT_MARGIN_OF_ERROR (0.0001f)
 
+static constexpr std::size_t HOUR_LABELS = 24; //The template has {hour0}..{hour23}
+static constexpr double GRAPH_WIDTH = 600.0; //Width of the graph area in the template
+
+
 bool SVG::GenerateSVGs(const NorwegianDay& norwegian_day) const
 {
   if (!norwegian_day.IsToday() && !norwegian_day.IsTomorrow())
@@ -33,56 +38,83 @@ bool SVG::GenerateSVGs(const NorwegianDay& norwegian_day) const
   Spotprice::AreaRateType area_rates;
   if (!::GetApp()->GetSpotprice()->GetEurRates(norwegian_day, area_rates))
     return false;
+  std::shared_ptr<const PriceStatistics> statistics;
+  if (!::GetApp()->GetSpotprice()->GetEurStatistics(norwegian_day, statistics) || statistics->GetAreaCount()!=area_rates.GetAreaCount())
+    return false;
 
-  double exchange_rate;
-  bool found_nok = ::GetApp()->GetCurrency()->GetExchangeRate(norwegian_day, exchange_rate);
+  //Converted once per currency, not per graph
+  Currency::ExchangeRates exchange_rates;
+  std::vector<Spotprice::AreaRateType> converted_rates;
+  if (::GetApp()->GetCurrency()->GetExchangeRates(norwegian_day, exchange_rates))
+  {
+    converted_rates = Currency::Convert(area_rates, exchange_rates);
+  }
+  std::vector<PriceStatistics> converted_statistics;
+  for (std::size_t currency_index=0; currency_index<converted_rates.size(); currency_index++)
+  {
+    converted_statistics.push_back(statistics->Converted(exchange_rates[currency_index]));
+  }
+  const std::vector<std::string>& currencies = ::GetApp()->GetCurrency()->GetCurrencies();
 
   bool status = true;
-  for (std::array<Area,5>::size_type area_index=0; area_index<area_rates.size(); area_index++)
+  for (std::size_t area_index=0; area_index<area_rates.GetAreaCount(); area_index++)
   {
-    status &= GenerateSVG(svg_template, norwegian_day, "EUR", 1.0, area_rates, area_index);
+    status &= GenerateSVG(svg_template, norwegian_day, "EUR", area_rates, *statistics, area_index);
 
-    if (found_nok)
+    for (std::size_t currency_index=0; currency_index<converted_rates.size(); currency_index++)
     {
-      status &= GenerateSVG(svg_template, norwegian_day, "NOK", exchange_rate, area_rates, area_index);
+      status &= GenerateSVG(svg_template, norwegian_day, currencies[currency_index], converted_rates[currency_index], converted_statistics[currency_index], area_index);
     }
   }
   return status;
 }
 
 /* All applications has an ugly part. For this application, this is it. Sorry. */
-bool SVG::GenerateSVG(const std::string& svg_template, const NorwegianDay& norwegian_day, const std::string& currency_name, const double& exchange_rate, const Spotprice::AreaRateType& area_rates, const std::array<Area,5>::size_type& area_index) const
+bool SVG::GenerateSVG(const std::string& svg_template, const NorwegianDay& norwegian_day, const std::string& currency_name, const Spotprice::AreaRateType& area_rates, const PriceStatistics& statistics, std::size_t area_index) const
 {
+  const ZoneCatalogue& zones = ::GetApp()->GetSpotprice()->GetZones();
+  const Area& area = zones[area_index];
   std::string svg_content = svg_template;
   
   boost::replace_all(svg_content, "{day}", std::to_string(norwegian_day.AsULong()));
   boost::replace_all(svg_content, "{currency}", currency_name);
-  boost::replace_all(svg_content, "{zone-id}", Spotprice::m_areas[area_index].id);
-  boost::replace_all(svg_content, "{zone-description}", Spotprice::m_areas[area_index].name);
+  boost::replace_all(svg_content, "{zone-id}", area.id);
+  boost::replace_all(svg_content, "{zone-description}", area.name);
   boost::replace_all(svg_content, "{date}", norwegian_day.ToString());
   
-  //Find min/max
-  double min_rate=0.0, max_rate=INT_MIN, current_rate;
-  for (std::array<Area,5>::size_type min_max_index=0; min_max_index<area_rates.size(); min_max_index++)
+  //Other zones drawn are the neighbours in the same timezone (like NO-1 to NO-5), so a distant zone never flattens the graph.
+  //Scale covers the drawn zones, and always includes 0
+  auto is_drawn = [&zones, &area](std::size_t line_index) {return zones[line_index].timezone == area.timezone;};
+  double min_rate = 0.0;
+  double max_rate = statistics[area_index].max;
+  for (std::size_t line_index=0; line_index<statistics.GetAreaCount(); line_index++)
   {
-    Spotprice::DayRateType eur_rates = area_rates[min_max_index];
-    for (unsigned int hour=0; hour<Spotprice::HOURS_PER_DAY; hour++)
+    if (is_drawn(line_index))
     {
-      current_rate = eur_rates[hour] * exchange_rate;
-      if (eur_rates[hour]*exchange_rate < min_rate)
-      {
-        min_rate = current_rate;
-      }
-      if (eur_rates[hour]*exchange_rate > max_rate)
-      {
-        max_rate = current_rate;
-      }
-      
-      if (min_max_index == area_index)
-      {
-        boost::replace_all(svg_content, fmt::sprintf("{hour%d}", hour%24), MQTT::DoubleToString(current_rate, 2));
-      }
+      min_rate = std::min(min_rate, statistics[line_index].min);
+      max_rate = std::max(max_rate, statistics[line_index].max);
+    }
+  }
+  double current_rate;
+
+  const PriceStatistics::Zone& zone_statistics = statistics[area_index];
+  boost::replace_all(svg_content, "{mean}", MQTT::DoubleToString(zone_statistics.mean, 2));
+  boost::replace_all(svg_content, "{median}", MQTT::DoubleToString(zone_statistics.median, 2));
+  boost::replace_all(svg_content, "{min}", MQTT::DoubleToString(zone_statistics.min, 2));
+  boost::replace_all(svg_content, "{max}", MQTT::DoubleToString(zone_statistics.max, 2));
+
+  //Hour labels show the average of all slots in that hour
+  std::span<const double> area_prices = area_rates[area_index];
+  std::size_t slots_per_hour = 60/area_rates.GetResolutionMinutes();
+  for (std::size_t hour=0; hour<HOUR_LABELS && hour*slots_per_hour<area_prices.size(); hour++)
+  {
+    double hour_sum = 0.0;
+    std::size_t slot_count = std::min(slots_per_hour, area_prices.size()-hour*slots_per_hour);
+    for (std::size_t slot=hour*slots_per_hour; slot<hour*slots_per_hour+slot_count; slot++)
+    {
+      hour_sum += area_prices[slot];
     }
+    boost::replace_all(svg_content, fmt::sprintf("{hour%d}", hour), MQTT::DoubleToString(hour_sum/static_cast<double>(slot_count), 2));
   }
   double delta_rate = max_rate - min_rate;
   int precision = 3 - ((delta_rate == 0) ? 0 : static_cast<int>(::log10(delta_rate)));
@@ -96,22 +128,27 @@ bool SVG::GenerateSVG(const std::string& svg_template, const NorwegianDay& norwe
   }
 
   //Draw price lines
-  int other_index = 0;
-  for (std::array<Area,5>::size_type line_index=0; line_index<area_rates.size(); line_index++)
+  std::string other_paths;
+  double slot_width = GRAPH_WIDTH/static_cast<double>(area_rates.GetSlotCount());
+  for (std::size_t line_index=0; line_index<area_rates.GetAreaCount(); line_index++)
   {
+    if (!is_drawn(line_index))
+    {
+      continue;
+    }
     std::stringstream ss;
 
-    Spotprice::DayRateType eur_rates = area_rates[line_index];
-    double previous_rate = eur_rates[0] * exchange_rate;
+    std::span<const double> prices = area_rates[line_index];
+    double previous_rate = prices[0];
     ss << "M50 " << rateToYPos(previous_rate, min_rate, max_rate);
     
-    for (unsigned int hour=0; hour<Spotprice::HOURS_PER_DAY; hour++)
+    for (std::size_t slot=0; slot<prices.size(); slot++)
     {
-      current_rate = eur_rates[hour] * exchange_rate;
+      current_rate = prices[slot];
       if (::fabs(current_rate - previous_rate) > FLOAT_MARGIN_OF_ERROR) {
         ss << " V" << rateToYPos(current_rate, min_rate, max_rate);
       }
-      ss << " h25";
+      ss << " h" << slot_width;
       previous_rate = current_rate;  
     }
     
@@ -121,15 +158,15 @@ bool SVG::GenerateSVG(const std::string& svg_template, const NorwegianDay& norwe
     }
     else
     {
-      other_index++;
-      boost::replace_all(svg_content, fmt::sprintf("{other%d}", other_index), ss.str());
+      other_paths += "<path d=\"" + ss.str() + "\"/>";
     }
   }
+  boost::replace_all(svg_content, "{others}", other_paths);
 
   //Write to file
   std::string filename = fmt::sprintf(norwegian_day.IsToday() ? "%s/today-%s-%s.svg" : "%s/tomorrow-%s-%s.svg",
                     ::GetApp()->GetConfig(Elspot::SVG_DIRECTORY_PROPERTY),
-                    Spotprice::m_areas[area_index].id,
+                    area.id,
                     currency_name);
 
   std::ofstream svg_file;
@@ -9,7 +9,7 @@ class SVG {
 public:
   [[nodiscard]] bool GenerateSVGs(const NorwegianDay& norwegian_day) const;
 private:
-  [[nodiscard]] bool GenerateSVG(const std::string& svg_template, const NorwegianDay& norwegian_day, const std::string& currency_name, const double& exchange_rate, const Spotprice::AreaRateType& area_rates, const std::array<Area,5>::size_type& area_index) const;
+  [[nodiscard]] bool GenerateSVG(const std::string& svg_template, const NorwegianDay& norwegian_day, const std::string& currency_name, const Spotprice::AreaRateType& area_rates, const PriceStatistics& statistics, std::size_t area_index) const; //area_rates and statistics already converted to currency_name
 private:
   [[nodiscard]] double dceil(double v, int p) const;
   [[nodiscard]] double dfloor(double v, int p) const;
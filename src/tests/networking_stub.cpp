@@ -58,6 +58,7 @@ void NetworkingStub::CallGET(const std::shared_ptr<Poco::Net::HTTPSClientSession
   Poco::Logger::get(Logger::DEFAULT).error(std::string("Stubbing GET for ") + uri.toString());
   if (uri.toString().starts_with("https://web-api.tp.entsoe.eu/"))
   {
+    m_spotprice_request_count++;
     static_cast<HTTPSClientSessionStub*>(session.get())->setStubResponse(m_spotprice_response_text, m_spotprice_response_code);
   }
   else if (uri.toString().starts_with("http://api.exchangeratesapi.io/"))
@@ -1,6 +1,7 @@
 #ifndef _NETWORKING_STUB_H_
 #define _NETWORKING_STUB_H_
 
+#include <atomic>
 #include <filesystem>
 
 #include "../networking.h"
@@ -37,11 +38,14 @@ public:
   std::shared_ptr<Poco::Net::HTTPSClientSession> CreateSession(const Poco::URI& uri) const override;
   void CallGET(const std::shared_ptr<Poco::Net::HTTPSClientSession>& session, const Poco::URI& uri, const std::string& accept) const override;
 
+  [[nodiscard]] unsigned int GetSpotpriceRequestCount() const {return m_spotprice_request_count;}
+
 private:
   const std::string m_spotprice_response_text;
   const Poco::Net::HTTPResponse::HTTPStatus m_spotprice_response_code;
   const std::string m_exchangerate_response_text;
   const Poco::Net::HTTPResponse::HTTPStatus m_exchangerate_response_code;
+  mutable std::atomic<unsigned int> m_spotprice_request_count{0}; //Areas are fetched concurrently
 };
 
 #endif // _NETWORKING_STUB_H_
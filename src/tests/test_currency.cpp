@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <map>
+
+#include "../currency.h"
+
+
+namespace
+{
+  const Currency::ExchangeRates FRIDAY_RATES{11.1};
+  const Currency::ExchangeRates MONDAY_RATES{11.3};
+}
+
+TEST(CurrencyTest, FillRateGapsFromLeadInTest) {
+  //2025-03-29 is a Saturday. The request also covered the Friday before it
+  std::map<unsigned long, Currency::ExchangeRates> fetched_rates{{20250328UL, FRIDAY_RATES}, {20250331UL, MONDAY_RATES}};
+  std::map<unsigned long, Currency::ExchangeRates> rates = Currency::FillRateGaps(fetched_rates, NorwegianDay(20250329UL), NorwegianDay(20250331UL), std::nullopt);
+  ASSERT_EQ(rates.size(), 3u);
+  EXPECT_EQ(rates[20250329UL], FRIDAY_RATES);
+  EXPECT_EQ(rates[20250330UL], FRIDAY_RATES);
+  EXPECT_EQ(rates[20250331UL], MONDAY_RATES);
+}
+
+TEST(CurrencyTest, FillRateGapsWithoutLeadInTest) {
+  //Range starts on a Saturday, with nothing fetched or cached before it
+  std::map<unsigned long, Currency::ExchangeRates> fetched_rates{{20250331UL, MONDAY_RATES}};
+  std::map<unsigned long, Currency::ExchangeRates> rates = Currency::FillRateGaps(fetched_rates, NorwegianDay(20250329UL), NorwegianDay(20250401UL), std::nullopt);
+  ASSERT_EQ(rates.size(), 4u);
+  EXPECT_EQ(rates[20250329UL], MONDAY_RATES);
+  EXPECT_EQ(rates[20250330UL], MONDAY_RATES);
+  EXPECT_EQ(rates[20250401UL], MONDAY_RATES);
+}
+
+TEST(CurrencyTest, FillRateGapsFromCacheTest) {
+  std::map<unsigned long, Currency::ExchangeRates> fetched_rates{{20250331UL, MONDAY_RATES}};
+  std::map<unsigned long, Currency::ExchangeRates> rates = Currency::FillRateGaps(fetched_rates, NorwegianDay(20250329UL), NorwegianDay(20250331UL), FRIDAY_RATES);
+  EXPECT_EQ(rates[20250329UL], FRIDAY_RATES); //Cached rate from before the range wins over a later one
+  EXPECT_EQ(rates[20250331UL], MONDAY_RATES);
+}
+
+TEST(CurrencyTest, FillRateGapsNothingFetchedTest) {
+  std::map<unsigned long, Currency::ExchangeRates> rates = Currency::FillRateGaps({}, NorwegianDay(20250329UL), NorwegianDay(20250331UL), std::nullopt);
+  EXPECT_TRUE(rates.empty());
+}
@@ -127,3 +127,63 @@ TEST(TestDay, DaysAfterTest) {
   EXPECT_TRUE(four_weeks_ago.AsNorwegianDay() != in_four_weeks.AsNorwegianDay());
   EXPECT_FALSE(utc_time.AsNorwegianDay() == four_weeks_ago.AsNorwegianDay());
 }
+
+TEST(TestDay, StartAsUTCTimeTest) {
+  EXPECT_EQ(NorwegianDay(20221231).StartAsUTCTime().AsUTCTimeT(), 1672441200L);
+  EXPECT_EQ(NorwegianDay(20220327).StartAsUTCTime().AsUTCTimeT(), 1648335600L);
+  EXPECT_EQ(NorwegianDay(20221030).StartAsUTCTime().AsUTCTimeT(), 1667080800L);
+  EXPECT_EQ(NorwegianDay(20221030).IncrementDaysCopy(1).AsULong(), 20221031UL);
+  EXPECT_EQ(NorwegianDay(20220326).IncrementDaysCopy(2).AsULong(), 20220328UL);
+  EXPECT_EQ(NorwegianDay(20221231).IncrementDaysCopy(1).AsULong(), 20230101UL);
+}
+
+TEST(TestDay, IncrementNorwegianDaysAcrossDSTTest) {
+  UTCTime before_wintertime(1667080800L); //Norwegian midnight 30.oktober 2022
+  EXPECT_EQ(before_wintertime.IncrementNorwegianDaysCopy(1).AsNorwegianTime().ToString(), "00:00.00 31.oktober 2022");
+  UTCTime before_summertime(1648335600L); //Norwegian midnight 27.mars 2022
+  EXPECT_EQ(before_summertime.IncrementNorwegianDaysCopy(1).AsNorwegianTime().ToString(), "00:00.00 28.mars 2022");
+}
+
+TEST(TestDay, CivilDaysTest) {
+  for (std::int64_t days=-800000; days<800000; days+=97) {
+    int year;
+    unsigned int month, day;
+    CivilFromDays(days, year, month, day);
+    EXPECT_EQ(DaysFromCivil(year, month, day), days);
+  }
+  EXPECT_EQ(DaysFromCivil(2024, 2, 29), 19782);
+  EXPECT_EQ(WeekdayFromDays(DaysFromCivil(2022, 12, 24)), 6u);
+  EXPECT_EQ(NorwegianDay(20230101).DaysAfter(NorwegianDay(20220101)), 365);
+  EXPECT_EQ(NorwegianDay(20250101).DaysAfter(NorwegianDay(20240101)), 366);
+}
+
+TEST(TestDay, DaylightSavingTableTest) {
+  EXPECT_EQ(UTCTime(1700000000L).DaylightSavingStart().AsUTCTimeT(), 1679792400L); //26.mars 2023 0100 UTC
+  EXPECT_EQ(UTCTime(1700000000L).DaylightSavingEnd().AsUTCTimeT(), 1698541200L); //29.oktober 2023 0100 UTC
+  EXPECT_EQ(UTCTime(4200000000L).DaylightSavingStart().AsNorwegianTime().ToString(), "03:00.00 25.mars 2103"); //Outside the table
+  EXPECT_EQ(UTCTime(-86400L).AsNorwegianTime().ToString(), "01:00.00 31.desember 1969");
+}
+
+TEST(TestDay, TodayTest) {
+  EXPECT_EQ(NorwegianDay::Today().AsULong(), UTCTime().AsNorwegianDay().AsULong());
+  EXPECT_EQ(NorwegianDay::Today().AsULong(), UTCTime().AsNorwegianDay().AsULong()); //Cached
+}
+
+TEST(TestDay, CompactTimeTest) {
+  EXPECT_EQ(sizeof(UTCTime), sizeof(std::time_t));
+  EXPECT_EQ(sizeof(NorwegianDay), sizeof(uint32_t));
+  UTCTime utc_time(1672444800L); //0000 UTC 31.desember 2022
+  utc_time.SetTime(12, 34, 56);
+  EXPECT_EQ(utc_time.AsUTCTimeT(), 1672444800L+12*3600+34*60+56);
+  utc_time.SetHour(1);
+  EXPECT_EQ(utc_time.GetHour(), 1);
+  EXPECT_EQ(utc_time.GetMinute(), 34);
+  EXPECT_EQ(utc_time.GetDay(), 31);
+
+  NorwegianDay norwegian_day(20240229UL);
+  EXPECT_EQ(norwegian_day.GetYear(), 2024);
+  EXPECT_EQ(norwegian_day.GetMonth(), 2);
+  EXPECT_EQ(norwegian_day.GetDay(), 29);
+  EXPECT_EQ(norwegian_day.AsULong(), 20240229UL);
+  EXPECT_TRUE(norwegian_day < norwegian_day.IncrementDaysCopy(1));
+}
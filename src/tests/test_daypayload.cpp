@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "../daypayload.h"
+
+using namespace std::string_literals;
+
+
+namespace
+{
+  struct DayPayloadData
+  {
+    std::vector<std::string> currencies{"nok"};
+    std::vector<double> exchange_rates{11.5};
+    std::vector<double> eur_prices{0.1, 0.3, 0.2};
+    std::vector<double> nok_prices{1.15, 3.45, 2.3};
+    std::vector<unsigned int> order{2, 0, 1};
+    std::vector<unsigned int> sorted{1, 2, 0};
+    PriceStatistics eur_statistics;
+    std::vector<PriceStatistics> currency_statistics;
+
+    DayPayloadData()
+    {
+      PriceSeries series(60, 3, 2);
+      std::vector<double> flat_prices{0.2, 0.2, 0.2};
+      EXPECT_TRUE(series.SetArea(0, 60, eur_prices));
+      EXPECT_TRUE(series.SetArea(1, 60, flat_prices));
+      eur_statistics = PriceStatistics(series);
+      currency_statistics.push_back(eur_statistics.Converted(exchange_rates[0]));
+    }
+
+    DayPayload Payload() const
+    {
+      DayPayload payload;
+      payload.day = NorwegianDay(20250330UL);
+      payload.resolution_minutes = 60;
+      payload.currencies = currencies;
+      payload.exchange_rates = exchange_rates;
+      payload.eur_prices = eur_prices;
+      payload.currency_prices = {nok_prices};
+      payload.order = order;
+      payload.sorted = sorted;
+      return payload;
+    }
+
+    SpreadPayload Spread() const
+    {
+      SpreadPayload payload;
+      payload.day = NorwegianDay(20250330UL);
+      payload.resolution_minutes = 60;
+      payload.currencies = currencies;
+      payload.eur_statistics = &eur_statistics;
+      payload.currency_statistics = {&currency_statistics[0]};
+      return payload;
+    }
+  };
+}
+
+TEST(DayPayloadTest, JSONTest) {
+  DayPayloadData data;
+  std::string json;
+  data.Payload().WriteJSON(json, 2);
+  EXPECT_EQ(json, "{\"day\":\"2025-03-30\",\"resolution\":60,\"exchangerate\":{\"nok\":11.50},\"eur\":[0.10,0.30,0.20],"
+                  "\"nok\":[1.15,3.45,2.30],\"order\":[2,0,1],\"sorted\":[1,2,0]}");
+}
+
+TEST(DayPayloadTest, JSONReusesBufferTest) {
+  DayPayloadData data;
+  std::string json;
+  data.Payload().WriteJSON(json, 2);
+  std::string first = json;
+  data.Payload().WriteJSON(json, 2);
+  EXPECT_EQ(json, first); //Cleared, not appended
+}
+
+TEST(DayPayloadTest, JSONWithStatisticsTest) {
+  DayPayloadData data;
+  DayPayload payload = data.Payload();
+  payload.eur_statistics = &data.eur_statistics[0];
+  payload.currency_statistics = {&data.currency_statistics[0][0]};
+  std::string json;
+  payload.WriteJSON(json, 2);
+  EXPECT_NE(json.find(",\"sorted\":[1,2,0],\"stats\":{\"eur\":{\"mean\":0.20,\"median\":0.20,\"stddev\":0.08,\"min\":0.10,\"minslot\":0,"
+                      "\"max\":0.30,\"maxslot\":1,\"p10\":0.12,\"p25\":0.15,\"p75\":0.25,\"p90\":0.28},\"nok\":{\"mean\":2.30,"), std::string::npos);
+  EXPECT_EQ(json.substr(json.size()-3), "}}}");
+}
+
+TEST(DayPayloadTest, SpreadJSONTest) {
+  DayPayloadData data;
+  std::string json;
+  data.Spread().WriteJSON(json, 2);
+  EXPECT_EQ(json, "{\"day\":\"2025-03-30\",\"resolution\":60,\"mean\":{\"eur\":0.00,\"nok\":0.00},\"eur\":[0.10,0.10,0.00],\"nok\":[1.15,1.15,0.00]}");
+}
+
+TEST(DayPayloadTest, CBORTest) {
+  DayPayloadData data;
+  std::string cbor;
+  data.Payload().WriteCBOR(cbor);
+
+  ASSERT_GE(cbor.size(), 14u);
+  EXPECT_EQ(static_cast<uint8_t>(cbor[0]), 0xA7); //Map with 6+1 pairs
+  EXPECT_EQ(cbor.substr(1, 4), "\x63" "day");
+  EXPECT_EQ(static_cast<uint8_t>(cbor[5]), 0x1A); //4-byte unsigned
+  EXPECT_EQ(static_cast<uint8_t>(cbor[6]), 0x01); //20250330 = 0x0134FEDA
+  EXPECT_EQ(static_cast<uint8_t>(cbor[7]), 0x34);
+  EXPECT_EQ(static_cast<uint8_t>(cbor[8]), 0xFE);
+  EXPECT_EQ(static_cast<uint8_t>(cbor[9]), 0xDA);
+
+  //Ends with "sorted":[1,2,0]
+  EXPECT_EQ(cbor.substr(cbor.size()-11), "\x66" "sorted" "\x83\x01\x02\x00"s);
+}
+
+TEST(DayPayloadTest, CBORWithStatisticsTest) {
+  DayPayloadData data;
+  DayPayload payload = data.Payload();
+  payload.eur_statistics = &data.eur_statistics[0];
+  payload.currency_statistics = {&data.currency_statistics[0][0]};
+  std::string cbor;
+  payload.WriteCBOR(cbor);
+
+  ASSERT_GE(cbor.size(), 1u);
+  EXPECT_EQ(static_cast<uint8_t>(cbor[0]), 0xA8); //Map with 6+1+1 pairs
+  EXPECT_NE(cbor.find("\x65" "stats" "\xA2" "\x63" "eur" "\xAB" "\x64" "mean"s), std::string::npos); //Map with 1+1 currencies, each a map with 7+4 pairs
+}
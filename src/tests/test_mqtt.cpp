@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <span>
+#include <string>
+
+#include "../application.h"
+#include "../mqtt.h"
+
+
+TEST(MQTTOptimiserTest, RestoredDayTest) {
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  elspot->SetConfig(Elspot::MQTT_OPTIMISER_PROPERTY, "true");
+  elspot->SetConfig(Elspot::MQTT_QUEUE_FILE_PROPERTY, "");
+  auto mqtt = std::make_shared<MQTT>();
+
+  //Cached from a snapshot, but published before the restart, so GotPrices is never called for it
+  const NorwegianDay today = NorwegianDay::Today();
+  const ZoneCatalogue& zones = elspot->GetSpotprice()->GetZones();
+  Spotprice::AreaRateType eur_rates(60, 24, zones.size());
+  std::span<double> prices = eur_rates[0];
+  for (std::size_t slot=0; slot<prices.size(); slot++)
+  {
+    prices[slot] = (3==slot || 4==slot) ? 1.0 : 10.0 + static_cast<double>(slot);
+  }
+  elspot->GetSpotprice()->SetCachedEurRates({{today.AsULong(), eur_rates}});
+  elspot->GetCurrency()->SetCachedRates({{today.AsULong(), Currency::ExchangeRates(elspot->GetCurrency()->GetCurrencies().size(), 10.0)}});
+
+  std::string request = std::string("{\"id\":\"restored\",\"zone\":\"") + zones[0].id + "\",\"query\":\"window\",\"slots\":2}";
+  std::string request_id, response;
+  ASSERT_TRUE(mqtt->AnswerOptimiserRequest(request, request_id, response));
+  EXPECT_NE(response.find("No prices for the day"), std::string::npos);
+
+  ASSERT_TRUE(mqtt->RestorePrices(today));
+  ASSERT_TRUE(mqtt->AnswerOptimiserRequest(request, request_id, response));
+  EXPECT_EQ(request_id, "restored");
+  EXPECT_NE(response.find("\"slots\":[3,4]"), std::string::npos) << response;
+
+  EXPECT_FALSE(mqtt->RestorePrices(today.IncrementDaysCopy(1))); //Not cached. Left to GotPrices
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include <Poco/DeflatingStream.h>
+
+#include "../networking.h"
+
+
+static std::string compress(const std::string& text, Poco::DeflatingStreamBuf::StreamType type)
+{
+  std::ostringstream compressed;
+  Poco::DeflatingOutputStream deflating_stream(compressed, type);
+  deflating_stream << text;
+  deflating_stream.close();
+  return compressed.str();
+}
+
+static std::string readAll(std::istream& stream)
+{
+  std::ostringstream result;
+  result << stream.rdbuf();
+  return result.str();
+}
+
+TEST(ResponseBodyTest, UncompressedTest) {
+  std::istringstream raw_stream("<xml>plain</xml>");
+  Poco::Net::HTTPResponse response;
+  ResponseBody response_body(raw_stream, response);
+  EXPECT_FALSE(response_body.IsCompressed());
+  EXPECT_EQ(readAll(response_body.Stream()), "<xml>plain</xml>");
+}
+
+TEST(ResponseBodyTest, GzipTest) {
+  std::istringstream raw_stream(compress("<xml>gzip</xml>", Poco::DeflatingStreamBuf::STREAM_GZIP));
+  Poco::Net::HTTPResponse response;
+  response.set("Content-Encoding", "gzip");
+  ResponseBody response_body(raw_stream, response);
+  EXPECT_TRUE(response_body.IsCompressed());
+  EXPECT_EQ(readAll(response_body.Stream()), "<xml>gzip</xml>");
+}
+
+TEST(ResponseBodyTest, DeflateTest) {
+  std::istringstream raw_stream(compress("{\"base\":\"EUR\"}", Poco::DeflatingStreamBuf::STREAM_ZLIB));
+  Poco::Net::HTTPResponse response;
+  response.set("Content-Encoding", "Deflate");
+  ResponseBody response_body(raw_stream, response);
+  EXPECT_TRUE(response_body.IsCompressed());
+  EXPECT_EQ(readAll(response_body.Stream()), "{\"base\":\"EUR\"}");
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../optimiser.h"
+
+
+namespace
+{
+  const std::vector<double> PRICES{5.0, 4.0, 1.0, 2.0, 6.0, 1.0, 1.0, 3.0};
+}
+
+TEST(OptimiserTest, CheapestWindowTest) {
+  Optimiser optimiser(PRICES);
+  Optimiser::Plan plan;
+  ASSERT_TRUE(optimiser.CheapestWindow(2, 0, PRICES.size(), plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{5, 6}));
+  EXPECT_DOUBLE_EQ(plan.cost, 2.0);
+
+  ASSERT_TRUE(optimiser.CheapestWindow(2, 0, 5, plan)); //Before slot 5
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{2, 3}));
+  EXPECT_DOUBLE_EQ(plan.cost, 3.0);
+
+  ASSERT_TRUE(optimiser.CheapestWindow(3, 0, PRICES.size(), plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{5, 6, 7}));
+  EXPECT_DOUBLE_EQ(plan.cost, 5.0);
+}
+
+TEST(OptimiserTest, CheapestWindowTieTest) {
+  Optimiser optimiser(std::vector<double>{1.0, 1.0, 1.0});
+  Optimiser::Plan plan;
+  ASSERT_TRUE(optimiser.CheapestWindow(2, 0, 3, plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{0, 1}));
+}
+
+TEST(OptimiserTest, CheapestSlotsTest) {
+  Optimiser optimiser(PRICES);
+  Optimiser::Plan plan;
+  ASSERT_TRUE(optimiser.CheapestSlots(3, 0, PRICES.size(), plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{2, 5, 6}));
+  EXPECT_DOUBLE_EQ(plan.cost, 3.0);
+
+  ASSERT_TRUE(optimiser.CheapestSlots(2, 3, 6, plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{3, 5}));
+  EXPECT_DOUBLE_EQ(plan.cost, 3.0);
+}
+
+TEST(OptimiserTest, ContiguousLoadTest) {
+  Optimiser optimiser(PRICES);
+  Optimiser::Plan plan;
+  //Heavy first step. Slot 2 (1.0) followed by 3 (2.0) costs 10*1+1*2, slot 5 followed by 6 costs 10*1+1*1
+  std::vector<double> profile{10.0, 1.0};
+  ASSERT_TRUE(optimiser.ScheduleLoad(profile, false, 0, PRICES.size(), plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{5, 6}));
+  EXPECT_DOUBLE_EQ(plan.cost, 11.0);
+
+  std::vector<double> flat{2.0, 2.0};
+  ASSERT_TRUE(optimiser.ScheduleLoad(flat, false, 0, 5, plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{2, 3}));
+  EXPECT_DOUBLE_EQ(plan.cost, 6.0);
+}
+
+TEST(OptimiserTest, InterruptibleLoadTest) {
+  Optimiser optimiser(PRICES);
+  Optimiser::Plan plan;
+  //Steps keep their order. The heavy step goes in slot 2, then the light steps in the cheapest later slots
+  std::vector<double> profile{10.0, 1.0, 1.0};
+  ASSERT_TRUE(optimiser.ScheduleLoad(profile, true, 0, PRICES.size(), plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{2, 5, 6}));
+  EXPECT_DOUBLE_EQ(plan.cost, 12.0);
+
+  //Heavy last step. Must come after the light ones
+  std::vector<double> reversed{1.0, 10.0};
+  ASSERT_TRUE(optimiser.ScheduleLoad(reversed, true, 0, PRICES.size(), plan));
+  EXPECT_EQ(plan.slots, (std::vector<unsigned int>{2, 5}));
+  EXPECT_DOUBLE_EQ(plan.cost, 11.0);
+}
+
+TEST(OptimiserTest, RejectsTest) {
+  Optimiser optimiser(PRICES);
+  Optimiser::Plan plan;
+  EXPECT_FALSE(optimiser.CheapestWindow(0, 0, PRICES.size(), plan));
+  EXPECT_FALSE(optimiser.CheapestWindow(3, 4, 6, plan));
+  EXPECT_FALSE(optimiser.CheapestSlots(1, 0, PRICES.size()+1, plan));
+  EXPECT_FALSE(optimiser.CheapestSlots(1, 5, 4, plan));
+  EXPECT_FALSE(optimiser.ScheduleLoad(std::vector<double>{}, true, 0, PRICES.size(), plan));
+  EXPECT_FALSE(optimiser.ScheduleLoad(std::vector<double>{1.0, 1.0, 1.0}, true, 6, PRICES.size(), plan));
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+
+#include "../outboundqueue.h"
+
+
+TEST(OutboundQueueTest, CollapsesStaleValuesTest) {
+  OutboundQueue queue("", 10);
+  EXPECT_TRUE(queue.Push("a", "1"));
+  EXPECT_TRUE(queue.Push("b", "2"));
+  EXPECT_TRUE(queue.Push("a", "3")); //Replaces "1", and moves behind "b"
+  EXPECT_EQ(queue.Size(), 2u);
+
+  OutboundQueue::Message message;
+  EXPECT_TRUE(queue.PopFront(message));
+  EXPECT_EQ(message.topic, "b");
+  EXPECT_EQ(message.payload, "2");
+  EXPECT_TRUE(queue.PopFront(message));
+  EXPECT_EQ(message.topic, "a");
+  EXPECT_EQ(message.payload, "3");
+  EXPECT_FALSE(queue.PopFront(message));
+  EXPECT_TRUE(queue.IsEmpty());
+}
+
+TEST(OutboundQueueTest, DropsOldestWhenFullTest) {
+  OutboundQueue queue("", 2);
+  EXPECT_TRUE(queue.Push("a", "1"));
+  EXPECT_TRUE(queue.Push("b", "2"));
+  EXPECT_FALSE(queue.Push("c", "3"));
+  EXPECT_EQ(queue.Size(), 2u);
+
+  OutboundQueue::Message message;
+  EXPECT_TRUE(queue.PopFront(message));
+  EXPECT_EQ(message.topic, "b");
+  EXPECT_TRUE(queue.Push("a", "4")); //"a" was dropped, so this is a new entry
+  EXPECT_EQ(queue.Size(), 2u);
+}
+
+TEST(OutboundQueueTest, SaveAndLoadTest) {
+  std::string filename = (std::filesystem::temp_directory_path() / "elspot_test.mqttqueue").string();
+  std::filesystem::remove(filename);
+  {
+    OutboundQueue queue(filename, 10);
+    EXPECT_TRUE(queue.Load()); //No file is an empty queue
+    EXPECT_TRUE(queue.Push("nordpool/today/NO-1/eur", "0.12", 1743372000));
+    EXPECT_TRUE(queue.Push("nordpool/today/NO-1/cbor", std::string("\x00\x01", 2)));
+    EXPECT_TRUE(queue.Save());
+  }
+
+  OutboundQueue queue(filename, 10);
+  EXPECT_TRUE(queue.Load());
+  ASSERT_EQ(queue.Size(), 2u);
+  OutboundQueue::Message message;
+  EXPECT_TRUE(queue.PopFront(message));
+  EXPECT_EQ(message.topic, "nordpool/today/NO-1/eur");
+  EXPECT_EQ(message.payload, "0.12");
+  EXPECT_EQ(message.expires_utc, 1743372000);
+  EXPECT_TRUE(queue.PopFront(message));
+  EXPECT_EQ(message.payload, std::string("\x00\x01", 2));
+  EXPECT_EQ(message.expires_utc, 0);
+  std::filesystem::remove(filename);
+}
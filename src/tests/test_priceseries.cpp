@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../priceseries.h"
+
+
+TEST(PriceSeriesTest, SetAreaSameResolutionTest) {
+  PriceSeries series(60, 24, 2);
+  std::vector<double> prices(24);
+  for (std::size_t hour=0; hour<prices.size(); hour++)
+  {
+    prices[hour] = static_cast<double>(hour);
+  }
+  EXPECT_TRUE(series.SetArea(1, 60, prices));
+  EXPECT_EQ(series[1][23], 23.0);
+  EXPECT_EQ(series[0][23], 0.0);
+}
+
+TEST(PriceSeriesTest, SetAreaRepeatsCoarserPricesTest) {
+  PriceSeries series(15, 23*4, 1);
+  std::vector<double> prices(23, 1.0);
+  prices[22] = 2.0;
+  EXPECT_TRUE(series.SetArea(0, 60, prices));
+  EXPECT_EQ(series[0][87], 1.0);
+  EXPECT_EQ(series[0][88], 2.0);
+  EXPECT_EQ(series[0][91], 2.0);
+}
+
+TEST(PriceSeriesTest, SetAreaRejectsMismatchTest) {
+  PriceSeries series(60, 24, 1);
+  std::vector<double> quarter_prices(96, 1.0);
+  EXPECT_FALSE(series.SetArea(0, 15, quarter_prices)); //Finer than the series
+  std::vector<double> short_prices(23, 1.0);
+  EXPECT_FALSE(series.SetArea(0, 60, short_prices));
+  EXPECT_FALSE(series.SetArea(1, 60, std::vector<double>(24, 1.0)));
+}
+
+TEST(PriceSeriesTest, ConvertedTest) {
+  PriceSeries eur(60, 3, 2);
+  std::vector<double> prices{1.0, 2.0, 3.0};
+  ASSERT_TRUE(eur.SetArea(1, 60, prices));
+
+  PriceSeries nok = eur.Converted(10.5);
+  EXPECT_EQ(nok.GetResolutionMinutes(), 60u);
+  EXPECT_EQ(nok.GetSlotCount(), 3u);
+  EXPECT_EQ(nok.GetAreaCount(), 2u);
+  EXPECT_DOUBLE_EQ(nok[0][0], 0.0);
+  EXPECT_DOUBLE_EQ(nok[1][0], 10.5);
+  EXPECT_DOUBLE_EQ(nok[1][2], 31.5);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "../quota.h"
+
+
+TEST(MonthlyQuotaTest, ReserveTest) {
+  MonthlyQuota quota(10, 3);
+  for (int request=0; request<7; request++)
+  {
+    EXPECT_TRUE(quota.TryConsume(MonthlyQuota::Priority::OPTIONAL, 202301));
+  }
+  EXPECT_FALSE(quota.TryConsume(MonthlyQuota::Priority::OPTIONAL, 202301)); //Only essential requests left
+  EXPECT_EQ(quota.GetRemaining(MonthlyQuota::Priority::OPTIONAL, 202301), 0u);
+  EXPECT_EQ(quota.GetRemaining(MonthlyQuota::Priority::ESSENTIAL, 202301), 3u);
+
+  for (int request=0; request<3; request++)
+  {
+    EXPECT_TRUE(quota.TryConsume(MonthlyQuota::Priority::ESSENTIAL, 202301));
+  }
+  EXPECT_FALSE(quota.TryConsume(MonthlyQuota::Priority::ESSENTIAL, 202301));
+
+  EXPECT_TRUE(quota.TryConsume(MonthlyQuota::Priority::OPTIONAL, 202302)); //New month
+  EXPECT_EQ(quota.GetRemaining(MonthlyQuota::Priority::ESSENTIAL, 202302), 9u);
+}
+
+TEST(MonthlyQuotaTest, UsageTest) {
+  MonthlyQuota quota(250, 25);
+  quota.SetUsage(202301, 240);
+  uint32_t month, used;
+  quota.GetUsage(month, used);
+  EXPECT_EQ(month, 202301u);
+  EXPECT_EQ(used, 240u);
+  EXPECT_FALSE(quota.TryConsume(MonthlyQuota::Priority::OPTIONAL, 202301));
+  EXPECT_TRUE(quota.TryConsume(MonthlyQuota::Priority::ESSENTIAL, 202301));
+
+  quota.SetUsage(202212, 1); //Older than what we have. Ignored
+  quota.GetUsage(month, used);
+  EXPECT_EQ(month, 202301u);
+  EXPECT_EQ(used, 241u);
+}
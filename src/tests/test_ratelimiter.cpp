@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../ratelimiter.h"
+
+
+TEST(RateLimiterTest, BurstTest) {
+  RateLimiter rate_limiter(1, 3); //One token pr minute, so no refill during the test
+  EXPECT_TRUE(rate_limiter.TryAcquire());
+  EXPECT_TRUE(rate_limiter.TryAcquire());
+  EXPECT_TRUE(rate_limiter.TryAcquire());
+  EXPECT_FALSE(rate_limiter.TryAcquire());
+}
+
+TEST(RateLimiterTest, RefillTest) {
+  RateLimiter rate_limiter(600, 1); //One token every 100ms
+  EXPECT_TRUE(rate_limiter.TryAcquire());
+  auto start = std::chrono::steady_clock::now();
+  rate_limiter.Acquire(RateLimiter::Priority::TODAY);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(90));
+}
+
+TEST(RateLimiterTest, PriorityTest) {
+  RateLimiter rate_limiter(600, 1);
+  EXPECT_TRUE(rate_limiter.TryAcquire());
+
+  std::vector<RateLimiter::Priority> served;
+  std::mutex served_mutex;
+  auto acquire = [&rate_limiter, &served, &served_mutex](RateLimiter::Priority priority)
+    {
+      rate_limiter.Acquire(priority);
+      const std::lock_guard<std::mutex> lock(served_mutex);
+      served.push_back(priority);
+    };
+  { //Thread scope. jthreads join when leaving scope
+    std::jthread backfill(acquire, RateLimiter::Priority::BACKFILL);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::jthread today(acquire, RateLimiter::Priority::TODAY); //Arrives later, but is served first
+  }
+  ASSERT_EQ(served.size(), 2u);
+  EXPECT_EQ(served[0], RateLimiter::Priority::TODAY);
+  EXPECT_EQ(served[1], RateLimiter::Priority::BACKFILL);
+}
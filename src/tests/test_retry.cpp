@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include "../retry.h"
+
+
+TEST(RetrySchedulerTest, ExponentialBackoffTest) {
+  RetryScheduler retry_scheduler(std::chrono::seconds(60), std::chrono::seconds(300), 0.0);
+  RetryScheduler::TimePoint now = std::chrono::system_clock::now();
+
+  EXPECT_TRUE(retry_scheduler.MayAttempt(1, now));
+  EXPECT_EQ(retry_scheduler.RegisterFail(1, now), now + std::chrono::seconds(60));
+  EXPECT_FALSE(retry_scheduler.MayAttempt(1, now + std::chrono::seconds(59)));
+  EXPECT_TRUE(retry_scheduler.MayAttempt(1, now + std::chrono::seconds(60)));
+  EXPECT_TRUE(retry_scheduler.MayAttempt(2, now)); //Other keys are not affected
+
+  EXPECT_EQ(retry_scheduler.RegisterFail(1, now), now + std::chrono::seconds(120));
+  EXPECT_EQ(retry_scheduler.RegisterFail(1, now), now + std::chrono::seconds(240));
+  EXPECT_EQ(retry_scheduler.RegisterFail(1, now), now + std::chrono::seconds(300)); //Capped
+  EXPECT_EQ(retry_scheduler.GetFailCount(1), 4u);
+
+  retry_scheduler.RegisterSuccess(1);
+  EXPECT_EQ(retry_scheduler.GetFailCount(1), 0u);
+  EXPECT_EQ(retry_scheduler.Size(), 0u);
+}
+
+TEST(RetrySchedulerTest, JitterTest) {
+  RetryScheduler retry_scheduler(std::chrono::seconds(100), std::chrono::seconds(100), 0.5);
+  RetryScheduler::TimePoint now = std::chrono::system_clock::now();
+  for (unsigned long key=0; key<100; key++)
+  {
+    RetryScheduler::TimePoint next_attempt = retry_scheduler.RegisterFail(key, now);
+    EXPECT_GE(next_attempt, now + std::chrono::seconds(50));
+    EXPECT_LE(next_attempt, now + std::chrono::seconds(150));
+  }
+}
+
+TEST(RetrySchedulerTest, ExpireTest) {
+  RetryScheduler retry_scheduler(std::chrono::seconds(60), std::chrono::seconds(600), 0.0);
+  RetryScheduler::TimePoint now = std::chrono::system_clock::now();
+  (void)retry_scheduler.RegisterFail(1, now);
+  (void)retry_scheduler.RegisterFail(1, now);
+  (void)retry_scheduler.RegisterFail(2, now + std::chrono::seconds(300));
+  EXPECT_EQ(retry_scheduler.Size(), 2u);
+
+  //Key 1 has not failed for max_delay after its retry time. It starts over at the initial delay
+  EXPECT_EQ(retry_scheduler.RegisterFail(1, now + std::chrono::seconds(800)), now + std::chrono::seconds(860));
+  EXPECT_EQ(retry_scheduler.GetFailCount(1), 1u);
+  EXPECT_EQ(retry_scheduler.GetFailCount(2), 1u);
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../singleflight.h"
+
+
+TEST(SingleFlightTest, ConcurrentCallsShareOneCallTest) {
+  SingleFlight<unsigned long, int> single_flight;
+  std::atomic<int> call_count{0};
+  std::vector<int> results(8, 0);
+  { //Thread scope. jthreads join when leaving scope
+    std::vector<std::jthread> callers;
+    for (std::size_t caller=0; caller<results.size(); caller++)
+    {
+      callers.emplace_back([&single_flight, &call_count, &results, caller]()
+        {
+          results[caller] = single_flight.Do(20240101, [&call_count]()
+            {
+              call_count++;
+              std::this_thread::sleep_for(std::chrono::milliseconds(200));
+              return 42;
+            });
+        });
+    }
+  }
+  EXPECT_EQ(call_count, 1);
+  for (int result : results)
+  {
+    EXPECT_EQ(result, 42);
+  }
+  EXPECT_EQ(single_flight.InFlight(), 0u);
+}
+
+TEST(SingleFlightTest, DifferentKeysAndLaterCallsRunAgainTest) {
+  SingleFlight<unsigned long, int> single_flight;
+  EXPECT_EQ(single_flight.Do(1, []() {return 1;}), 1);
+  EXPECT_EQ(single_flight.Do(2, []() {return 2;}), 2);
+  EXPECT_EQ(single_flight.Do(1, []() {return 3;}), 3); //Results are not cached
+}
+
+TEST(SingleFlightTest, ExceptionIsSharedTest) {
+  SingleFlight<unsigned long, int> single_flight;
+  EXPECT_THROW(single_flight.Do(1, []() -> int {throw std::runtime_error("failed");}), std::runtime_error);
+  EXPECT_EQ(single_flight.InFlight(), 0u);
+}
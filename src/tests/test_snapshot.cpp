@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../application.h"
+#include "../snapshot.h"
+
+
+namespace
+{
+  const NorwegianDay PUBLISHED_TODAY(20250330UL);
+  const NorwegianDay PUBLISHED_TOMORROW(20250331UL);
+
+  std::string SnapshotFilename(const char* name)
+  {
+    std::string filename = (std::filesystem::temp_directory_path() / name).string();
+    std::filesystem::remove(filename);
+    return filename;
+  }
+
+  //Fills the caches of elspot with one day of spotprices and exchange rates, and saves them with PUBLISHED_TODAY/PUBLISHED_TOMORROW as published
+  void SaveTestSnapshot(const std::shared_ptr<Elspot>& elspot, const std::string& filename)
+  {
+    Spotprice::AreaRateType eur_rates(15, 92, elspot->GetSpotprice()->GetZones().size()); //Summertime starts, so 23 hours
+    std::span<double> prices = eur_rates.AllPrices();
+    for (std::size_t index=0; index<prices.size(); index++)
+    {
+      prices[index] = static_cast<double>(index) / 100.0;
+    }
+    elspot->GetSpotprice()->SetCachedEurRates({{PUBLISHED_TODAY.AsULong(), eur_rates}});
+    elspot->GetCurrency()->SetCachedRates({{PUBLISHED_TODAY.AsULong(), Currency::ExchangeRates(elspot->GetCurrency()->GetCurrencies().size(), 11.5)}});
+    elspot->GetCurrency()->GetQuota().SetUsage(202503, 17);
+
+    Snapshot snapshot(filename);
+    snapshot.SetPublishedDays(PUBLISHED_TODAY, PUBLISHED_TOMORROW);
+    ASSERT_TRUE(snapshot.Save());
+  }
+
+  //Offset of the resolution of the first spotprice day. Its slot count follows it
+  std::streamoff FirstDayResolutionOffset(const std::shared_ptr<Elspot>& elspot)
+  {
+    std::streamoff offset = 5*sizeof(uint32_t); //Magic, version, published today and tomorrow, zone count
+    for (const Area& area : elspot->GetSpotprice()->GetZones())
+    {
+      offset += static_cast<std::streamoff>(sizeof(uint32_t) + area.id.size());
+    }
+    return offset + 2*sizeof(uint32_t); //Day count, day
+  }
+
+  void OverwriteUInt32(const std::string& filename, std::streamoff offset, uint32_t value)
+  {
+    std::fstream stream(filename, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(offset);
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  //Empty caches, as after a restart
+  void Restart(const std::shared_ptr<Elspot>& elspot)
+  {
+    elspot->SetSpotprice(std::make_shared<Spotprice>(elspot->GetSpotprice()->GetZones(), Spotprice::DEFAULT_REQUESTS_PER_MINUTE));
+    elspot->SetCurrency(std::make_shared<Currency>(Currency::DEFAULT_CURRENCIES, Currency::DEFAULT_MONTHLY_QUOTA));
+  }
+}
+
+TEST(SnapshotTest, SaveAndLoadTest) {
+  std::string filename = SnapshotFilename("elspot_test.snapshot");
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  SaveTestSnapshot(elspot, filename);
+  Spotprice::AreaRateType saved_rates;
+  ASSERT_TRUE(elspot->GetSpotprice()->GetEurRates(PUBLISHED_TODAY, saved_rates));
+
+  Restart(elspot);
+  Snapshot snapshot(filename);
+  ASSERT_TRUE(snapshot.Load());
+
+  std::map<unsigned long, Spotprice::AreaRateType> eur_rates;
+  elspot->GetSpotprice()->GetCachedEurRates(eur_rates);
+  ASSERT_EQ(eur_rates.size(), 1u);
+  const Spotprice::AreaRateType& loaded_rates = eur_rates[PUBLISHED_TODAY.AsULong()];
+  EXPECT_EQ(loaded_rates.GetResolutionMinutes(), 15u);
+  EXPECT_EQ(loaded_rates.GetSlotCount(), 92u);
+  EXPECT_EQ(loaded_rates.GetAreaCount(), saved_rates.GetAreaCount());
+  EXPECT_TRUE(std::equal(loaded_rates.AllPrices().begin(), loaded_rates.AllPrices().end(), saved_rates.AllPrices().begin(), saved_rates.AllPrices().end()));
+
+  std::map<unsigned long, Currency::ExchangeRates> exchange_rates;
+  elspot->GetCurrency()->GetCachedRates(exchange_rates);
+  ASSERT_EQ(exchange_rates.size(), 1u);
+  EXPECT_EQ(exchange_rates[PUBLISHED_TODAY.AsULong()], Currency::ExchangeRates(elspot->GetCurrency()->GetCurrencies().size(), 11.5));
+
+  uint32_t quota_month, quota_used;
+  elspot->GetCurrency()->GetQuota().GetUsage(quota_month, quota_used);
+  EXPECT_EQ(quota_month, 202503u);
+  EXPECT_EQ(quota_used, 17u);
+  std::filesystem::remove(filename);
+}
+
+TEST(SnapshotTest, PublishedDaysTest) {
+  std::string filename = SnapshotFilename("elspot_test_published.snapshot");
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  SaveTestSnapshot(elspot, filename);
+
+  Restart(elspot);
+  Snapshot snapshot(filename);
+  NorwegianDay today(0UL), tomorrow(0UL);
+  EXPECT_FALSE(snapshot.GetPublishedDays(today, tomorrow)); //Nothing published before it is loaded
+  ASSERT_TRUE(snapshot.Load());
+  ASSERT_TRUE(snapshot.GetPublishedDays(today, tomorrow));
+  EXPECT_EQ(today, PUBLISHED_TODAY);
+  EXPECT_EQ(tomorrow, PUBLISHED_TOMORROW);
+  std::filesystem::remove(filename);
+}
+
+TEST(SnapshotTest, RejectsOtherVersionTest) {
+  std::string filename = SnapshotFilename("elspot_test_version.snapshot");
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  SaveTestSnapshot(elspot, filename);
+  { //Version follows the magic number
+    std::fstream stream(filename, std::ios::binary | std::ios::in | std::ios::out);
+    stream.seekp(sizeof(uint32_t));
+    uint32_t other_version = 0;
+    stream.write(reinterpret_cast<const char*>(&other_version), sizeof(other_version));
+  }
+
+  Restart(elspot);
+  Snapshot snapshot(filename);
+  EXPECT_FALSE(snapshot.Load());
+  EXPECT_FALSE(elspot->GetSpotprice()->HasEurRate(PUBLISHED_TODAY));
+  NorwegianDay today(0UL), tomorrow(0UL);
+  EXPECT_FALSE(snapshot.GetPublishedDays(today, tomorrow));
+  std::filesystem::remove(filename);
+}
+
+TEST(SnapshotTest, RejectsTruncatedFileTest) {
+  std::string filename = SnapshotFilename("elspot_test_truncated.snapshot");
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  SaveTestSnapshot(elspot, filename);
+  std::filesystem::resize_file(filename, std::filesystem::file_size(filename)-1); //Cuts into the quota, after everything else is read
+
+  Restart(elspot);
+  Snapshot snapshot(filename);
+  EXPECT_FALSE(snapshot.Load());
+  EXPECT_FALSE(elspot->GetSpotprice()->HasEurRate(PUBLISHED_TODAY)); //Nothing is applied from a file that is not complete
+  std::map<unsigned long, Currency::ExchangeRates> exchange_rates;
+  elspot->GetCurrency()->GetCachedRates(exchange_rates);
+  EXPECT_TRUE(exchange_rates.empty());
+  std::filesystem::remove(filename);
+}
+
+TEST(SnapshotTest, RejectsCorruptSpotpriceLayoutTest) {
+  std::string filename = SnapshotFilename("elspot_test_layout.snapshot");
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  const std::streamoff resolution_offset = FirstDayResolutionOffset(elspot);
+
+  //Resolution, slot count. None of them is a day of 23, 24 or 25 hours at a supported resolution
+  const std::vector<std::pair<uint32_t, uint32_t>> corrupt_layouts{{15, 0}, {120, 12}, {60, 22}, {15, 93}, {0, 24}};
+  for (const auto& corrupt_layout : corrupt_layouts)
+  {
+    SaveTestSnapshot(elspot, filename);
+    OverwriteUInt32(filename, resolution_offset, corrupt_layout.first);
+    OverwriteUInt32(filename, resolution_offset+static_cast<std::streamoff>(sizeof(uint32_t)), corrupt_layout.second);
+
+    Restart(elspot);
+    Snapshot snapshot(filename);
+    EXPECT_FALSE(snapshot.Load()) << corrupt_layout.first << " minutes, " << corrupt_layout.second << " slots";
+    EXPECT_FALSE(elspot->GetSpotprice()->HasEurRate(PUBLISHED_TODAY));
+  }
+
+  //The layout written by SaveTestSnapshot, to make sure the offset is right
+  SaveTestSnapshot(elspot, filename);
+  OverwriteUInt32(filename, resolution_offset, 15);
+  OverwriteUInt32(filename, resolution_offset+static_cast<std::streamoff>(sizeof(uint32_t)), 92);
+  Restart(elspot);
+  Snapshot snapshot(filename);
+  EXPECT_TRUE(snapshot.Load());
+  std::filesystem::remove(filename);
+}
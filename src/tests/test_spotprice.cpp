@@ -64,6 +64,19 @@ TEST(SpotpriceCronTest, ToSummertimeXMLResponseTest) {
                                                           exchangerate_response_text, Poco::Net::HTTPResponse::HTTP_OK);
   EXPECT_TRUE(stubNetworkResponse(networking_stub, dummy_day, eur_rates));
   EXPECT_EQ(eur_rates[0][0], 194.84);
+  EXPECT_EQ(eur_rates.GetSlotCount(), 23u);
+}
+
+TEST(SpotpriceCronTest, MalformedPriceXMLResponseTest) {
+  NorwegianDay dummy_day = UTCTime(1648375200).AsNorwegianDay();
+  Spotprice::AreaRateType eur_rates;
+  std::string spotprice_response_text, exchangerate_response_text;
+  fileContent(std::filesystem::path("src/tests/to_summertime.xml"), spotprice_response_text);
+  fileContent(std::filesystem::path("src/tests/exchangerates.json"), exchangerate_response_text);
+  spotprice_response_text.replace(spotprice_response_text.find("194.84"), 6, "194,84"); //Well-formed XML, but not a number
+  auto networking_stub = std::make_shared<NetworkingStub>(spotprice_response_text, Poco::Net::HTTPResponse::HTTP_OK,
+                                                          exchangerate_response_text, Poco::Net::HTTPResponse::HTTP_OK);
+  EXPECT_FALSE(stubNetworkResponse(networking_stub, dummy_day, eur_rates));
 }
 
 TEST(SpotpriceCronTest, ToWintertimeXMLResponseTest) {
@@ -76,6 +89,7 @@ TEST(SpotpriceCronTest, ToWintertimeXMLResponseTest) {
                                                           exchangerate_response_text, Poco::Net::HTTPResponse::HTTP_OK);
   EXPECT_TRUE(stubNetworkResponse(networking_stub, dummy_day, eur_rates));
   EXPECT_EQ(eur_rates[0][7], 106.63);
+  EXPECT_EQ(eur_rates.GetSlotCount(), 25u);
 }
 
 TEST(SpotpriceCronTest, CurveTypeA03XMLResponseTest) {
@@ -91,3 +105,35 @@ TEST(SpotpriceCronTest, CurveTypeA03XMLResponseTest) {
   EXPECT_EQ(eur_rates[0][14], 13.17);
   EXPECT_EQ(eur_rates[0][15], 13.42);
 }
+
+TEST(SpotpriceBackfillTest, KeepsCompleteDaysOfIncompleteRangeTest) {
+  std::string spotprice_response_text, exchangerate_response_text;
+  fileContent(std::filesystem::path("src/tests/to_summertime.xml"), spotprice_response_text);
+  fileContent(std::filesystem::path("src/tests/exchangerates.json"), exchangerate_response_text);
+  auto networking_stub = std::make_shared<NetworkingStub>(spotprice_response_text, Poco::Net::HTTPResponse::HTTP_OK,
+                                                          exchangerate_response_text, Poco::Net::HTTPResponse::HTTP_OK);
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  elspot->SetNetworking(networking_stub);
+
+  //Response only covers 27.mars 2022, so the range is incomplete. The covered day must still be cached
+  EXPECT_FALSE(elspot->GetSpotprice()->Backfill(NorwegianDay(20220326), NorwegianDay(20220327)));
+  EXPECT_FALSE(elspot->GetSpotprice()->HasEurRate(NorwegianDay(20220326)));
+  EXPECT_TRUE(elspot->GetSpotprice()->HasEurRate(NorwegianDay(20220327)));
+}
+
+TEST(SpotpriceBackfillTest, SplitRangeIntoRequestsTest) {
+  std::string spotprice_response_text, exchangerate_response_text;
+  fileContent(std::filesystem::path("src/tests/to_summertime.xml"), spotprice_response_text);
+  fileContent(std::filesystem::path("src/tests/exchangerates.json"), exchangerate_response_text);
+  auto networking_stub = std::make_shared<NetworkingStub>(spotprice_response_text, Poco::Net::HTTPResponse::HTTP_OK,
+                                                          exchangerate_response_text, Poco::Net::HTTPResponse::HTTP_OK);
+  auto elspot = std::make_shared<Elspot>();
+  elspot->init(0, nullptr);
+  elspot->SetNetworking(networking_stub);
+
+  //367 days is more than one request may cover, so every area is requested twice
+  EXPECT_FALSE(elspot->GetSpotprice()->Backfill(NorwegianDay(20220326), NorwegianDay(20230327)));
+  EXPECT_EQ(networking_stub->GetSpotpriceRequestCount(), 2*elspot->GetSpotprice()->GetZones().size());
+  EXPECT_TRUE(elspot->GetSpotprice()->HasEurRate(NorwegianDay(20220327)));
+}
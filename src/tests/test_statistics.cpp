@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "../statistics.h"
+#include "../zones.h"
+
+
+namespace
+{
+  PriceSeries TwoAreas() //Area 0 is 1..10 in reverse, area 1 is flat 5
+  {
+    PriceSeries series(60, 10, 2);
+    std::vector<double> falling(10), flat(10, 5.0);
+    for (std::size_t slot=0; slot<falling.size(); slot++)
+    {
+      falling[slot] = static_cast<double>(10-slot);
+    }
+    EXPECT_TRUE(series.SetArea(0, 60, falling));
+    EXPECT_TRUE(series.SetArea(1, 60, flat));
+    return series;
+  }
+}
+
+TEST(PriceStatisticsTest, ZoneTest) {
+  PriceStatistics statistics(TwoAreas());
+  ASSERT_EQ(statistics.GetAreaCount(), 2u);
+
+  const PriceStatistics::Zone& zone = statistics[0];
+  EXPECT_DOUBLE_EQ(zone.mean, 5.5);
+  EXPECT_DOUBLE_EQ(zone.median, 5.5);
+  EXPECT_DOUBLE_EQ(zone.standard_deviation, std::sqrt(8.25));
+  EXPECT_DOUBLE_EQ(zone.min, 1.0);
+  EXPECT_EQ(zone.min_slot, 9u);
+  EXPECT_DOUBLE_EQ(zone.max, 10.0);
+  EXPECT_EQ(zone.max_slot, 0u);
+  EXPECT_DOUBLE_EQ(zone.percentiles[0], 1.9); //p10
+  EXPECT_DOUBLE_EQ(zone.percentiles[1], 3.25); //p25
+  EXPECT_DOUBLE_EQ(zone.percentiles[2], 7.75); //p75
+  EXPECT_DOUBLE_EQ(zone.percentiles[3], 9.1); //p90
+}
+
+TEST(PriceStatisticsTest, FlatZoneTest) {
+  PriceStatistics statistics(TwoAreas());
+  const PriceStatistics::Zone& zone = statistics[1];
+  EXPECT_DOUBLE_EQ(zone.mean, 5.0);
+  EXPECT_DOUBLE_EQ(zone.standard_deviation, 0.0);
+  EXPECT_EQ(zone.min_slot, 0u); //First of equal prices
+  EXPECT_EQ(zone.max_slot, 0u);
+}
+
+TEST(PriceStatisticsTest, SpreadTest) {
+  PriceStatistics statistics(TwoAreas());
+  std::span<const double> spreads = statistics.GetSlotSpreads();
+  ASSERT_EQ(spreads.size(), 10u);
+  EXPECT_DOUBLE_EQ(spreads[0], 5.0); //10 against 5
+  EXPECT_DOUBLE_EQ(spreads[5], 0.0);
+  EXPECT_DOUBLE_EQ(spreads[9], 4.0); //1 against 5
+  EXPECT_DOUBLE_EQ(statistics.GetMeanSpread(), 0.5);
+  EXPECT_DOUBLE_EQ(statistics.GetMin(), 1.0);
+  EXPECT_DOUBLE_EQ(statistics.GetMax(), 10.0);
+}
+
+TEST(PriceStatisticsTest, ConvertedTest) {
+  PriceStatistics converted = PriceStatistics(TwoAreas()).Converted(2.0);
+  EXPECT_DOUBLE_EQ(converted[0].mean, 11.0);
+  EXPECT_DOUBLE_EQ(converted[0].percentiles[3], 18.2);
+  EXPECT_EQ(converted[0].min_slot, 9u);
+  EXPECT_DOUBLE_EQ(converted.GetSlotSpreads()[0], 10.0);
+  EXPECT_DOUBLE_EQ(converted.GetMeanSpread(), 1.0);
+}
+
+TEST(PriceStatisticsTest, EmptyTest) {
+  PriceStatistics statistics(PriceSeries{});
+  EXPECT_EQ(statistics.GetAreaCount(), 0u);
+  EXPECT_TRUE(statistics.GetSlotSpreads().empty());
+  EXPECT_DOUBLE_EQ(statistics.GetMax(), 0.0);
+}
+
+TEST(PriceStatisticsTest, TimezoneSpreadTest) {
+  ZoneCatalogue zones("NO-1,FI");
+  const NorwegianDay day(20250115UL);
+  const std::vector<long> slot_offsets = zones.GetSlotOffsets(day, 60);
+  ASSERT_EQ(slot_offsets, (std::vector<long>{0, -1})); //Finnish midnight is 2300 Norwegian time
+
+  //NO-1 slot n costs n. FI costs 2 more at the same UTC hour, so FI slot n (an hour earlier than NO-1 slot n) costs n+1
+  PriceSeries series(60, 24, 2);
+  std::vector<double> no1(24), fi(24);
+  for (std::size_t slot=0; slot<24; slot++)
+  {
+    no1[slot] = static_cast<double>(slot);
+    fi[slot] = static_cast<double>(slot) + 1.0;
+  }
+  ASSERT_TRUE(series.SetArea(0, 60, no1));
+  ASSERT_TRUE(series.SetArea(1, 60, fi));
+
+  PriceStatistics statistics(series, slot_offsets);
+  std::span<const double> spreads = statistics.GetSlotSpreads();
+  ASSERT_EQ(spreads.size(), 24u);
+  EXPECT_DOUBLE_EQ(spreads[0], 2.0);
+  EXPECT_DOUBLE_EQ(spreads[22], 2.0);
+  EXPECT_DOUBLE_EQ(spreads[23], 0.0); //FI is in the next day. Only NO-1 is left
+  EXPECT_DOUBLE_EQ(statistics.GetMeanSpread(), 2.0); //Over the 23 hours both days cover
+  EXPECT_DOUBLE_EQ(statistics[1].mean - statistics[0].mean, 1.0); //Zone means are still over each local day
+
+  PriceStatistics unaligned(series);
+  EXPECT_DOUBLE_EQ(unaligned.GetSlotSpreads()[0], 1.0); //Slot by slot, which compares different hours
+}
@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+
+#include "../day.h"
+#include "../timezone.h"
+
+
+TEST(TestTimezone, LookupTest) {
+  ASSERT_NE(Timezone::Get("Europe/Helsinki"), nullptr);
+  EXPECT_STREQ(Timezone::Get("Europe/Helsinki")->GetName(), "Europe/Helsinki");
+  EXPECT_EQ(Timezone::Get("Mars/Olympus_Mons"), nullptr);
+  EXPECT_STREQ(Timezone::Norway().GetName(), "Europe/Oslo");
+}
+
+TEST(TestTimezone, OffsetTest) {
+  const Timezone& helsinki = *Timezone::Get("Europe/Helsinki");
+  EXPECT_EQ(helsinki.GetOffset(1648342800L-1), 2*3600); //Just before daylight saving 2022
+  EXPECT_EQ(helsinki.GetOffset(1648342800L), 3*3600);
+  EXPECT_EQ(helsinki.GetOffset(1667091600L), 2*3600);
+  EXPECT_EQ(Timezone::Get("UTC")->GetOffset(1648342800L), 0);
+  EXPECT_EQ(Timezone::Get("UTC")->DaylightSavingStart(2022), 0);
+  EXPECT_EQ(Timezone::Get("Europe/London")->GetOffset(1648342800L), 3600);
+}
+
+TEST(TestTimezone, LocalDayTest) {
+  const Timezone& helsinki = *Timezone::Get("Europe/Helsinki");
+  UTCTime before_norwegian_midnight(1672441200L-1800); //23:30 30.desember 2022 in Norway, 00:30 31.desember in Finland
+  EXPECT_EQ(before_norwegian_midnight.AsNorwegianDay().AsULong(), 20221230UL);
+  EXPECT_EQ(before_norwegian_midnight.AsLocalDay(helsinki).AsULong(), 20221231UL);
+  EXPECT_EQ(before_norwegian_midnight.AsLocalTime(helsinki).ToString(), "00:30.00 31.desember 2022");
+
+  EXPECT_EQ(NorwegianDay(20221231).StartAsUTCTime(helsinki).AsUTCTimeT(), 1672437600L);
+  EXPECT_EQ(NorwegianDay(20220327).StartAsUTCTime(helsinki).AsUTCTimeT(), 1648332000L); //Still standard time at midnight
+  EXPECT_EQ(NorwegianDay(20220328).StartAsUTCTime(helsinki).AsUTCTimeT(), 1648414800L); //Summer time
+  EXPECT_EQ(NorwegianDay(20221030).StartAsUTCTime(*Timezone::Get("Europe/London")).AsUTCTimeT(), 1667084400L);
+}
@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+
+#include "../zones.h"
+
+
+TEST(ZoneCatalogueTest, DefaultZonesTest) {
+  ZoneCatalogue zones;
+  ASSERT_EQ(zones.size(), 5u);
+  EXPECT_EQ(zones[0].id, "NO-1");
+  EXPECT_EQ(zones[4].code, "10Y1001A1001A48H");
+}
+
+TEST(ZoneCatalogueTest, ConfiguredZonesTest) {
+  ZoneCatalogue zones(" SE-3, FI ,XX-9,SE-3,,DK-1");
+  ASSERT_EQ(zones.size(), 3u); //Unknown and duplicate ids are skipped
+  EXPECT_EQ(zones[0].id, "SE-3");
+  EXPECT_EQ(zones[1].id, "FI");
+  EXPECT_EQ(zones[2].id, "DK-1");
+}
+
+TEST(ZoneCatalogueTest, FallbackTest) {
+  ZoneCatalogue unknown_zones("XX");
+  ASSERT_EQ(unknown_zones.size(), 5u); //Never empty
+  EXPECT_EQ(unknown_zones[0].id, "NO-1");
+  EXPECT_EQ(ZoneCatalogue(" ").size(), 5u);
+}
+
+TEST(ZoneCatalogueTest, TimezoneTest) {
+  for (const Area& area : ZoneCatalogue::KnownZones()) {
+    EXPECT_NE(area.timezone, nullptr) << area.id;
+  }
+  ZoneCatalogue zones("NO-1,FI");
+  EXPECT_STREQ(zones[0].timezone->GetName(), "Europe/Oslo");
+  EXPECT_STREQ(zones[1].timezone->GetName(), "Europe/Helsinki");
+}
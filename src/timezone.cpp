@@ -0,0 +1,115 @@
+#include "timezone.h"
+
+#include <array>
+
+#include "day.h"
+
+
+namespace
+{
+  struct Transitions
+  {
+    std::time_t start_utc;
+    std::time_t end_utc;
+  };
+
+  constexpr Transitions CalculateEUTransitions(int year)
+  {
+    return {static_cast<std::time_t>(DaysFromCivil(year, 3, LastSundayInMonth(year, 3))*UTCTime::SECONDS_PER_DAY + 60*60),
+            static_cast<std::time_t>(DaysFromCivil(year, 10, LastSundayInMonth(year, 10))*UTCTime::SECONDS_PER_DAY + 60*60)};
+  }
+
+  //EU transitions happen at the same UTC instant in every timezone, so one table serves all of them
+  constexpr int TRANSITIONS_FIRST_YEAR = 1970;
+  constexpr int TRANSITIONS_YEARS = 200;
+  constexpr std::array<Transitions, TRANSITIONS_YEARS> EU_TRANSITIONS = []()
+  {
+    std::array<Transitions, TRANSITIONS_YEARS> table{};
+    for (int index=0; index<TRANSITIONS_YEARS; index++)
+    {
+      table[static_cast<std::size_t>(index)] = CalculateEUTransitions(TRANSITIONS_FIRST_YEAR+index);
+    }
+    return table;
+  }();
+  static_assert(EU_TRANSITIONS[2022-TRANSITIONS_FIRST_YEAR].start_utc == 1648342800);
+  static_assert(EU_TRANSITIONS[2022-TRANSITIONS_FIRST_YEAR].end_utc == 1667091600);
+
+  Transitions GetEUTransitions(int year)
+  {
+    int index = year - TRANSITIONS_FIRST_YEAR;
+    return (index>=0 && index<TRANSITIONS_YEARS) ? EU_TRANSITIONS[static_cast<std::size_t>(index)] : CalculateEUTransitions(year);
+  }
+
+  constexpr std::time_t HOUR = 60*60;
+  constexpr std::array<Timezone, 16> TIMEZONES
+    {
+      Timezone("Europe/Oslo",       1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Stockholm",  1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Copenhagen", 1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Helsinki",   2*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Tallinn",    2*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Riga",       2*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Vilnius",    2*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Berlin",     1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Amsterdam",  1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Brussels",   1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Paris",      1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Vienna",     1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/Warsaw",     1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("Europe/London",     0,      Timezone::DaylightSaving::EU),
+      Timezone("CET",               1*HOUR, Timezone::DaylightSaving::EU),
+      Timezone("UTC",               0,      Timezone::DaylightSaving::NONE)
+    };
+}
+
+
+std::time_t Timezone::GetOffset(std::time_t time_utc) const
+{
+  if (DaylightSaving::NONE == m_daylight_saving)
+  {
+    return m_standard_offset;
+  }
+
+  int year;
+  unsigned int month, day;
+  CivilFromDays(FloorDiv(time_utc, UTCTime::SECONDS_PER_DAY), year, month, day);
+  return GetOffset(time_utc, year);
+}
+
+std::time_t Timezone::GetOffset(std::time_t time_utc, int year) const
+{
+  if (DaylightSaving::NONE == m_daylight_saving)
+  {
+    return m_standard_offset;
+  }
+
+  Transitions transitions = GetEUTransitions(year);
+  return (time_utc<transitions.start_utc || time_utc>=transitions.end_utc) ? m_standard_offset : m_standard_offset+HOUR;
+}
+
+std::time_t Timezone::DaylightSavingStart(int year) const
+{
+  return (DaylightSaving::NONE == m_daylight_saving) ? 0 : GetEUTransitions(year).start_utc;
+}
+
+std::time_t Timezone::DaylightSavingEnd(int year) const
+{
+  return (DaylightSaving::NONE == m_daylight_saving) ? 0 : GetEUTransitions(year).end_utc;
+}
+
+const Timezone* Timezone::Get(const std::string& name)
+{
+  for (const Timezone& timezone : TIMEZONES)
+  {
+    if (name == timezone.GetName())
+    {
+      return &timezone;
+    }
+  }
+  return nullptr;
+}
+
+const Timezone& Timezone::Norway()
+{
+  return TIMEZONES[0];
+}
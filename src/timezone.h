@@ -0,0 +1,40 @@
+#ifndef _TIMEZONE_H_
+#define _TIMEZONE_H_
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+
+//A timezone compiled from its IANA rules (standard offset and daylight saving rule). Only the rules in use since 1996 are known,
+//which covers every bidding zone. Transitions are looked up in a table per year, so a conversion never calls into the system tz database
+class Timezone
+{
+public:
+  enum class DaylightSaving
+  {
+    NONE,
+    EU    //+1 hour from 0100 UTC last Sunday in March to 0100 UTC last Sunday in October
+  };
+
+public:
+  constexpr Timezone(const char* name, std::time_t standard_offset, DaylightSaving daylight_saving)
+    : m_name(name), m_standard_offset(standard_offset), m_daylight_saving(daylight_saving) {}
+
+public:
+  [[nodiscard]] const char* GetName() const {return m_name;}
+  [[nodiscard]] std::time_t GetOffset(std::time_t time_utc) const; //Seconds to add to UTC to get local time
+  [[nodiscard]] std::time_t GetOffset(std::time_t time_utc, int year) const; //When the UTC year is already known
+  [[nodiscard]] std::time_t DaylightSavingStart(int year) const; //UTC. 0 if the timezone has no daylight saving
+  [[nodiscard]] std::time_t DaylightSavingEnd(int year) const;
+
+  [[nodiscard]] static const Timezone* Get(const std::string& name); //nullptr if unknown
+  [[nodiscard]] static const Timezone& Norway();
+
+private:
+  const char* m_name;
+  std::time_t m_standard_offset;
+  DaylightSaving m_daylight_saving;
+};
+
+#endif // _TIMEZONE_H_
@@ -0,0 +1,82 @@
+#include "zones.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include <Poco/Logger.h>
+
+#include "logger.h"
+
+
+ZoneCatalogue::ZoneCatalogue(const std::string& zone_ids)
+{
+  std::istringstream stream(zone_ids);
+  std::string zone_id;
+  while (std::getline(stream, zone_id, ','))
+  {
+    zone_id.erase(0, zone_id.find_first_not_of(" \t"));
+    zone_id.erase(zone_id.find_last_not_of(" \t")+1);
+    if (zone_id.empty())
+    {
+      continue;
+    }
+
+    const std::vector<Area>& known_zones = KnownZones();
+    auto known_zone = std::find_if(known_zones.begin(), known_zones.end(), [&zone_id](const Area& area) {return area.id == zone_id;});
+    if (known_zone == known_zones.end())
+    {
+      Poco::Logger::get(Logger::DEFAULT).error(std::string("Unknown bidding zone ")+zone_id);
+    }
+    else if (std::none_of(m_areas.begin(), m_areas.end(), [&zone_id](const Area& area) {return area.id == zone_id;}))
+    {
+      m_areas.push_back(*known_zone);
+    }
+  }
+
+  if (m_areas.empty())
+  {
+    Poco::Logger::get(Logger::DEFAULT).error(std::string("No known bidding zones in \"")+zone_ids+"\". Using "+DEFAULT_ZONES);
+    *this = ZoneCatalogue(DEFAULT_ZONES);
+  }
+}
+
+std::vector<long> ZoneCatalogue::GetSlotOffsets(const NorwegianDay& norwegian_day, unsigned int resolution_minutes) const
+{
+  std::vector<long> slot_offsets;
+  slot_offsets.reserve(m_areas.size());
+  const std::time_t reference_start = m_areas.empty() ? 0 : norwegian_day.StartAsUTCTime(*m_areas[0].timezone).AsUTCTimeT();
+  for (const Area& area : m_areas)
+  {
+    slot_offsets.push_back(static_cast<long>((norwegian_day.StartAsUTCTime(*area.timezone).AsUTCTimeT() - reference_start) / (static_cast<std::time_t>(resolution_minutes)*60)));
+  }
+  return slot_offsets;
+}
+
+const std::vector<Area>& ZoneCatalogue::KnownZones()
+{
+  static const std::vector<Area> known_zones
+    {
+      {"NO-1",  "10YNO-1--------2", "Oslo", Timezone::Get("Europe/Oslo")},
+      {"NO-2",  "10YNO-2--------T", "Kristiansand", Timezone::Get("Europe/Oslo")},
+      {"NO-3",  "10YNO-3--------J", "Trondheim", Timezone::Get("Europe/Oslo")},
+      {"NO-4",  "10YNO-4--------9", "Tromsø", Timezone::Get("Europe/Oslo")},
+      {"NO-5",  "10Y1001A1001A48H", "Bergen", Timezone::Get("Europe/Oslo")},
+      {"SE-1",  "10Y1001A1001A44P", "Luleå", Timezone::Get("Europe/Stockholm")},
+      {"SE-2",  "10Y1001A1001A45N", "Sundsvall", Timezone::Get("Europe/Stockholm")},
+      {"SE-3",  "10Y1001A1001A46L", "Stockholm", Timezone::Get("Europe/Stockholm")},
+      {"SE-4",  "10Y1001A1001A47J", "Malmö", Timezone::Get("Europe/Stockholm")},
+      {"DK-1",  "10YDK-1--------W", "Western Denmark", Timezone::Get("Europe/Copenhagen")},
+      {"DK-2",  "10YDK-2--------M", "Eastern Denmark", Timezone::Get("Europe/Copenhagen")},
+      {"FI",    "10YFI-1--------U", "Finland", Timezone::Get("Europe/Helsinki")},
+      {"EE",    "10Y1001A1001A39I", "Estonia", Timezone::Get("Europe/Tallinn")},
+      {"LV",    "10YLV-1001A00074", "Latvia", Timezone::Get("Europe/Riga")},
+      {"LT",    "10YLT-1001A0008Q", "Lithuania", Timezone::Get("Europe/Vilnius")},
+      {"DE-LU", "10Y1001A1001A82H", "Germany-Luxembourg", Timezone::Get("Europe/Berlin")},
+      {"NL",    "10YNL----------L", "Netherlands", Timezone::Get("Europe/Amsterdam")},
+      {"BE",    "10YBE----------2", "Belgium", Timezone::Get("Europe/Brussels")},
+      {"FR",    "10YFR-RTE------C", "France", Timezone::Get("Europe/Paris")},
+      {"AT",    "10YAT-APG------L", "Austria", Timezone::Get("Europe/Vienna")},
+      {"PL",    "10YPL-AREA-----S", "Poland", Timezone::Get("Europe/Warsaw")}
+    };
+  return known_zones;
+}
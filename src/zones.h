@@ -0,0 +1,46 @@
+#ifndef _ZONES_H_
+#define _ZONES_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "day.h"
+#include "timezone.h"
+
+
+struct Area
+{
+  std::string id;   //Used in MQTT topics and file names, like "NO-1"
+  std::string code; //ENTSO-E EIC code
+  std::string name;
+  const Timezone* timezone; //Local delivery days of the zone are days in this timezone
+};
+
+
+//Bidding zones to fetch and publish, in configured order. The index of a zone is used as area index in PriceSeries
+class ZoneCatalogue
+{
+public:
+  static constexpr const char* DEFAULT_ZONES = "NO-1,NO-2,NO-3,NO-4,NO-5";
+
+public:
+  ZoneCatalogue() : ZoneCatalogue(DEFAULT_ZONES) {}
+  explicit ZoneCatalogue(const std::string& zone_ids); //Comma-separated ids. Unknown ids are logged and skipped. Never empty, falls back to DEFAULT_ZONES
+
+public:
+  [[nodiscard]] std::size_t size() const {return m_areas.size();}
+  [[nodiscard]] const Area& operator[](std::size_t area_index) const {return m_areas[area_index];}
+  [[nodiscard]] std::vector<Area>::const_iterator begin() const {return m_areas.begin();}
+  [[nodiscard]] std::vector<Area>::const_iterator end() const {return m_areas.end();}
+
+  //Slots the local day of each zone starts after the local day of zone 0, in UTC. Negative for zones east of zone 0. Indexed like the zones
+  [[nodiscard]] std::vector<long> GetSlotOffsets(const NorwegianDay& norwegian_day, unsigned int resolution_minutes) const;
+
+  [[nodiscard]] static const std::vector<Area>& KnownZones();
+
+private:
+  std::vector<Area> m_areas;
+};
+
+#endif // _ZONES_H_